@@ -15,12 +15,10 @@ int main() {
 
     auto classFile = parser.consumeClassFile();
 
-    auto thisClassIndex = classFile.getThisClass();
-    auto thisClassCPInfo = parser.getContext()->getConstant(thisClassIndex);
-    auto thisClass = thisClassCPInfo.asConstClassInfo();
-    auto thisClassNameIdx = thisClass->getIndex();
+    const auto& constantPool = classFile.getConstantPool();
 
-    auto thisClassName = parser.getContext()->getConstantUTF8(thisClassNameIdx);
+    auto thisClassIndex = classFile.getThisClass();
+    auto thisClassName = constantPool.utf8(constantPool.classNameIndex(thisClassIndex));
 
     std::cout << "public class " << thisClassName << std::endl;
     std::cout << "  minor version: " << classFile.getMinorVersion() << std::endl;
@@ -53,44 +51,39 @@ int main() {
     // Constant pool
     std::cout << "Constant pool:" << std::endl;
 
-    int constantPoolIdx = 1;
-    for (auto constant : classFile.getConstantPool()) {
+    for (std::uint16_t constantPoolIdx = 1; constantPoolIdx < constantPool.getCount(); constantPoolIdx++) {
+        auto tag = constantPool.getTag(constantPoolIdx);
+        if (tag == ConstantPool::UNUSABLE) {
+            continue;
+        }
         if (constantPoolIdx < 10){
             std::cout << " ";
         }
         std::cout << "  #" << constantPoolIdx << " = ";
-        if (constant.tag == jvmg::CPInfo::CONSTANT_Methodref) {
+        if (tag == ConstantPool::CONSTANT_Methodref) {
             std::cout << "Methodref         ";
-            auto classIndex = (constant.info[0] << 8) | constant.info[1];
-            auto nameAndTypeIndex = (constant.info[2] << 8) | constant.info[3];
-            std::cout << "#" << classIndex << ".#" << nameAndTypeIndex;
-        } else if (constant.tag == jvmg::CPInfo::CONSTANT_Class) {
+            auto methodRef = constantPool.memberRef(constantPoolIdx);
+            std::cout << "#" << methodRef.classIndex << ".#" << methodRef.nameAndTypeIndex;
+        } else if (tag == ConstantPool::CONSTANT_Class) {
             std::cout << "Class             ";
-            auto nameIndex = (constant.info[0] << 8) | constant.info[1];
-            std::cout << "#" << nameIndex;
-        } else if (constant.tag == jvmg::CPInfo::CONSTANT_NameAndType) {
+            std::cout << "#" << constantPool.classNameIndex(constantPoolIdx);
+        } else if (tag == ConstantPool::CONSTANT_NameAndType) {
             std::cout << "NameAndType       ";
-            auto nameIndex = (constant.info[0] << 8) | constant.info[1];
-            auto typeIndex = (constant.info[2] << 8) | constant.info[3];
-            std::cout << "#" << nameIndex << ":#" << typeIndex;
-        } else if (constant.tag == jvmg::CPInfo::CONSTANT_Utf8) {
+            auto nameAndType = constantPool.nameAndType(constantPoolIdx);
+            std::cout << "#" << nameAndType.nameIndex << ":#" << nameAndType.descriptorIndex;
+        } else if (tag == ConstantPool::CONSTANT_Utf8) {
             std::cout << "Utf8              ";
-            auto utf8Const = constant.asUTF8Info();
-            auto length = utf8Const->getLength();
-            for (auto i = 0; i < length; i++) {
-                std::cout << utf8Const->getByte(i);
-            }
+            std::cout << constantPool.utf8(constantPoolIdx);
         }
         std::cout << std::endl;
-        constantPoolIdx++;
     }
 
     std::cout << "{" << std::endl;
 
     auto method = classFile.getMethods()[0];
 
-    auto name = parser.getContext()->getConstantUTF8(method.nameIndex);
-    auto descriptor = parser.getContext()->getConstantUTF8(method.descriptorIndex);
+    auto name = constantPool.utf8(method.nameIndex);
+    auto descriptor = constantPool.utf8(method.descriptorIndex);
     if (name == "<init>" and descriptor == "()V" and (method.accessFlags & ClassFile::MethodInfo::ACC_PUBLIC)) {
         std::cout << "  public Minimum();" << std::endl;
     }
@@ -108,12 +101,12 @@ int main() {
     std::cout << "    Code:" << std::endl;
     std::cout << "      stack=" << code->maxStack << ", locals=" << code->maxLocals << std::endl;
 
-    for (const auto& instruction : code->code) {
+    for (const auto& instruction : code->getCode()) {
         std::cout << "        ";
         if (instruction.getOpcodeByte() == 0x2A) {
             std::cout << "aload_0";
         } else if (instruction.getOpcodeByte() == 0xB7) {
-            std::cout << "invokespecial #" << ((instruction.getOperands()[0] << 8) | instruction.getOperands()[1]);
+            std::cout << "invokespecial #" << instruction.getOperand();
         } else if (instruction.getOpcodeByte() == 0xB1) {
             std::cout << "return";
         }
@@ -122,7 +115,7 @@ int main() {
     }
 
     std::cout << "      LineNumberTable:" << std::endl;
-    auto lineNumberTable = ((LineNumberAttribute*) code->attributes[0]->info)->lineNumberTable;
+    auto lineNumberTable = ((LineNumberAttribute*) code->getAttributes()[0]->info)->getLineNumberTable();
 
     std::cout << "        line " << lineNumberTable[0].lineNumber << ": " << lineNumberTable[0].startPC << std::endl;
 
@@ -130,7 +123,7 @@ int main() {
 
     auto sourceFile = (SourceFileAttribute*) classFile.getAttributes()[0]->info;
     auto sourceFileIndex = sourceFile->sourceFileIndex;
-    auto sourceFileName = parser.getContext()->getConstantUTF8(sourceFileIndex);
+    auto sourceFileName = constantPool.utf8(sourceFileIndex);
     std::cout << "SourceFile: \"" << sourceFileName << "\"" << std::endl;
 
     return 0;
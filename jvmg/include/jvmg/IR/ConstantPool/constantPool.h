@@ -0,0 +1,141 @@
+//
+// Created by Micky on 2/9/2024.
+//
+
+#ifndef _CONSTANT_POOL_H
+#define _CONSTANT_POOL_H
+
+#include "jvmg/util/util.h"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace jvmg {
+    // The constant pool of one class, stored as a dense tag array, an offset table, and a single buffer holding
+    // every entry's payload (the bytes after the tag, exactly as they appear in the class file).
+    // Indices are constant pool indices: they start at 1, and the slot after a Long or Double is UNUSABLE.
+    class ConstantPool : public Serializable {
+    public:
+        enum ConstantType : std::uint8_t {
+            UNUSABLE = 0,
+            CONSTANT_Class = 7,
+            CONSTANT_Fieldref = 9,
+            CONSTANT_Methodref  = 10,
+            CONSTANT_InterfaceMethodref = 11,
+            CONSTANT_String = 8,
+            CONSTANT_Integer = 3,
+            CONSTANT_Float = 4,
+            CONSTANT_Long = 5,
+            CONSTANT_Double = 6,
+            CONSTANT_NameAndType = 12,
+            CONSTANT_Utf8 = 1,
+            CONSTANT_MethodHandle = 15,
+            CONSTANT_MethodType = 16,
+            CONSTANT_Dynamic = 17,
+            CONSTANT_InvokeDynamic = 18,
+            CONSTANT_Module = 19,
+            CONSTANT_Package = 20,
+        };
+
+        // Fieldref, Methodref and InterfaceMethodref
+        struct MemberRef {
+            std::uint16_t classIndex;
+            std::uint16_t nameAndTypeIndex;
+        };
+
+        struct NameAndType {
+            std::uint16_t nameIndex;
+            std::uint16_t descriptorIndex;
+        };
+
+        struct MethodHandle {
+            std::uint8_t referenceKind;
+            std::uint16_t referenceIndex;
+        };
+
+        // Dynamic and InvokeDynamic
+        struct DynamicRef {
+            std::uint16_t bootstrapMethodAttrIndex;
+            std::uint16_t nameAndTypeIndex;
+        };
+
+        ConstantPool() : tags{UNUSABLE}, offsets{0, 0} {}
+
+        // Payload size of a fixed-size entry, or 0 for Utf8 and unknown tags
+        static std::size_t getPayloadSize(ConstantType tag);
+
+        // Long and Double take up two slots
+        static bool isWide(ConstantType tag) { return tag == CONSTANT_Long || tag == CONSTANT_Double; }
+
+        void reserve(std::size_t entries, std::size_t payloadBytes);
+        // Removes every entry but keeps the allocated storage, and moves the pool to a new generation
+        void clear();
+        // Changes only when entries are removed, so indices read under one generation keep their meaning in it
+        [[nodiscard]] std::uint64_t getGeneration() const { return generation; }
+        // Bytes allocated for entries, used or not
+        [[nodiscard]] std::size_t getCapacityBytes() const {
+            return tags.capacity() * sizeof(ConstantType) + offsets.capacity() * sizeof(std::uint32_t) + data.capacity();
+        }
+
+        // Appends an entry whose payload is already encoded and returns its index. This and the add* calls below
+        // throw std::length_error once the pool has no index left for the entry.
+        std::uint16_t add(ConstantType tag, std::span<const std::uint8_t> payload);
+
+        std::uint16_t addClass(std::uint16_t nameIndex);
+        std::uint16_t addFieldRef(std::uint16_t classIndex, std::uint16_t nameAndTypeIndex);
+        std::uint16_t addMethodRef(std::uint16_t classIndex, std::uint16_t nameAndTypeIndex);
+        std::uint16_t addInterfaceMethodRef(std::uint16_t classIndex, std::uint16_t nameAndTypeIndex);
+        std::uint16_t addString(std::uint16_t stringIndex);
+        std::uint16_t addInteger(std::int32_t value);
+        std::uint16_t addFloat(float value);
+        std::uint16_t addLong(std::int64_t value);
+        std::uint16_t addDouble(double value);
+        std::uint16_t addNameAndType(std::uint16_t nameIndex, std::uint16_t descriptorIndex);
+        std::uint16_t addUTF8(std::string_view value);
+        std::uint16_t addMethodHandle(std::uint8_t referenceKind, std::uint16_t referenceIndex);
+        std::uint16_t addMethodType(std::uint16_t descriptorIndex);
+        std::uint16_t addInvokeDynamic(std::uint16_t bootstrapMethodAttrIndex, std::uint16_t nameAndTypeIndex);
+
+        // constant_pool_count: one more than the highest index
+        [[nodiscard]] std::uint16_t getCount() const { return static_cast<std::uint16_t>(tags.size()); }
+
+        [[nodiscard]] ConstantType getTag(std::uint16_t index) const { return tags.at(index); }
+        [[nodiscard]] std::span<const std::uint8_t> getPayload(std::uint16_t index) const;
+
+        // Typed accessors. Each throws std::invalid_argument if the entry has a different tag.
+        [[nodiscard]] std::uint16_t classNameIndex(std::uint16_t index) const { return read16(offsetOf(index, CONSTANT_Class)); }
+        [[nodiscard]] std::uint16_t stringIndex(std::uint16_t index) const { return read16(offsetOf(index, CONSTANT_String)); }
+        [[nodiscard]] std::uint16_t methodTypeDescriptorIndex(std::uint16_t index) const { return read16(offsetOf(index, CONSTANT_MethodType)); }
+        [[nodiscard]] MemberRef memberRef(std::uint16_t index) const;
+        [[nodiscard]] NameAndType nameAndType(std::uint16_t index) const;
+        [[nodiscard]] MethodHandle methodHandle(std::uint16_t index) const;
+        [[nodiscard]] DynamicRef dynamicRef(std::uint16_t index) const;
+        [[nodiscard]] std::int32_t intValue(std::uint16_t index) const;
+        [[nodiscard]] float floatValue(std::uint16_t index) const;
+        [[nodiscard]] std::int64_t longValue(std::uint16_t index) const;
+        [[nodiscard]] double doubleValue(std::uint16_t index) const;
+
+        // Raw modified UTF-8 bytes. The view stays valid until the pool is modified.
+        [[nodiscard]] std::string_view utf8(std::uint16_t index) const;
+
+    private:
+        void _serialize() override;
+
+        void checkRoomFor(ConstantType tag) const;
+        [[nodiscard]] std::uint32_t offsetOf(std::uint16_t index, ConstantType expected) const;
+        [[nodiscard]] std::uint16_t read16(std::uint32_t offset) const { return (data[offset] << 8) | data[offset + 1]; }
+        [[nodiscard]] std::uint32_t read32(std::uint32_t offset) const {
+            return (static_cast<std::uint32_t>(read16(offset)) << 16) | read16(offset + 2);
+        }
+
+        std::vector<ConstantType> tags;
+        // Entry i's payload is data[offsets[i], offsets[i + 1]); payloads are stored in index order
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint8_t> data;
+        std::uint64_t generation = 0;
+    };
+}
+
+#endif //_CONSTANT_POOL_H
@@ -0,0 +1,80 @@
+//
+// Created by Micky on 2/20/2024.
+//
+
+#ifndef _CONSTANT_POOL_BUILDER_H
+#define _CONSTANT_POOL_BUILDER_H
+
+#include "jvmg/IR/ConstantPool/constantPool.h"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace jvmg {
+    // Adds entries to a constant pool by value, returning the index of an identical entry when there already is
+    // one. Lookups go through a flat open-addressing table of indices, hashed on an entry's tag and payload, so each
+    // call costs one hash of the payload no matter how large the pool is.
+    // Entries added to the pool other than through the builder are not seen, and may then be duplicated.
+    class ConstantPoolBuilder {
+    public:
+        // Indexes the entries pool already has, the first of any duplicates winning
+        explicit ConstantPoolBuilder(std::shared_ptr<ConstantPool> pool = std::make_shared<ConstantPool>());
+
+        ConstantPoolBuilder(const ConstantPoolBuilder&) = delete;
+        ConstantPoolBuilder& operator=(const ConstantPoolBuilder&) = delete;
+
+        // Starts over on another pool, keeping the table's storage
+        void reset(std::shared_ptr<ConstantPool> newPool);
+
+        [[nodiscard]] const std::shared_ptr<ConstantPool> &getPool() const { return pool; }
+
+        // Each of these throws std::length_error once the pool has no index left for the entry, and utf8 throws
+        // std::invalid_argument for values longer than 65535 bytes.
+        std::uint16_t utf8(std::string_view value);
+        // Internal form, such as "java/lang/Object" or "[I"
+        std::uint16_t classRef(std::string_view name);
+        std::uint16_t string(std::string_view value);
+        std::uint16_t integer(std::int32_t value);
+        // Float and Double entries are compared bit for bit, so 0.0 and -0.0 stay apart
+        std::uint16_t floatingPoint(float value);
+        std::uint16_t longInteger(std::int64_t value);
+        std::uint16_t doublePrecision(double value);
+        std::uint16_t nameAndType(std::string_view name, std::string_view descriptor);
+        std::uint16_t fieldRef(std::string_view owner, std::string_view name, std::string_view descriptor);
+        std::uint16_t methodRef(std::string_view owner, std::string_view name, std::string_view descriptor);
+        std::uint16_t interfaceMethodRef(std::string_view owner, std::string_view name, std::string_view descriptor);
+        std::uint16_t methodHandle(std::uint8_t referenceKind, std::uint16_t referenceIndex);
+        std::uint16_t methodType(std::string_view descriptor);
+        std::uint16_t invokeDynamic(std::uint16_t bootstrapMethodAttrIndex, std::string_view name, std::string_view descriptor);
+
+        // Any entry, given its payload as ConstantPool stores it
+        std::uint16_t add(ConstantPool::ConstantType tag, std::span<const std::uint8_t> payload);
+
+    private:
+        std::uint16_t addIndex(ConstantPool::ConstantType tag, std::uint16_t index);
+        std::uint16_t addIndexPair(ConstantPool::ConstantType tag, std::uint16_t first, std::uint16_t second);
+        std::uint16_t addMemberRef(ConstantPool::ConstantType tag, std::string_view owner, std::string_view name,
+                                   std::string_view descriptor);
+
+        static std::uint64_t hash(ConstantPool::ConstantType tag, std::span<const std::uint8_t> payload);
+        // Index of the entry equal to tag and payload, or 0 if the table has none
+        [[nodiscard]] std::uint16_t find(std::uint64_t entryHash, ConstantPool::ConstantType tag,
+                                         std::span<const std::uint8_t> payload) const;
+        // Puts index into the first free slot of its probe sequence
+        void insert(std::uint64_t entryHash, std::uint16_t index);
+        void grow();
+
+        std::shared_ptr<ConstantPool> pool;
+        // A slot holds the top 16 bits of the entry's hash above its index, or 0 when empty (index 0 is never an
+        // entry). Its size is a power of two, kept at most three quarters full.
+        std::vector<std::uint32_t> slots;
+        std::size_t used = 0;
+        // Holds a Utf8 payload while it is looked up
+        std::vector<std::uint8_t> scratch;
+    };
+}
+
+#endif //_CONSTANT_POOL_BUILDER_H
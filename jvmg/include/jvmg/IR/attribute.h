@@ -5,19 +5,40 @@
 #ifndef _ATTRIBUTE_H
 #define _ATTRIBUTE_H
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <vector>
 #include <string>
-#include <map>
-#include "jvmg/IR/instruction.h"
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include "jvmg/IR/instructionStream.h"
 #include "jvmg/util/util.h"
 
 namespace jvmg {
+    class Parser;
+
+    // The info of an attribute: everything after attribute_length
     struct Attribute : public Serializable {
         virtual ~Attribute() = default;
+
+        // True if info, the bytes the attribute was read from, still describe it. Attributes compare the fields
+        // they expose, and count as changed once a non-const accessor has handed out the rest of their contents.
+        [[nodiscard]] virtual bool matchesInfo(std::span<const std::uint8_t> /*info*/) const { return !isModified(); }
+        [[nodiscard]] bool isModified() const { return modified.load(std::memory_order_relaxed); }
+
+    protected:
+        void markModified() { modified.store(true, std::memory_order_relaxed); }
+
+    private:
+        std::atomic<bool> modified = false;
     };
 
-    struct AttributeInfo : public Serializable {
+    struct AttributeInfo final : public SourceBacked {
         enum AttributeNameTag {
             CONSTANT_VALUE = 0,
             CODE,
@@ -38,7 +59,8 @@ namespace jvmg {
             RUNTIME_VISIBLE_PARAMETER_ANNOTATIONS,
             RUNTIME_INVISIBLE_PARAMETER_ANNOTATIONS,
             ANNOTATION_DEFAULT,
-            BOOTSTRAP_METHODS
+            BOOTSTRAP_METHODS,
+            UNKNOWN
         };
 
         AttributeInfo(
@@ -54,11 +76,32 @@ namespace jvmg {
             info = nullptr;
         }
 
-        static std::map<std::string, AttributeNameTag> attributeNameTagMap;
+        // Names of the known attributes, indexed by tag
+        static constexpr std::array<std::string_view, UNKNOWN> attributeNames = {
+                "ConstantValue",
+                "Code",
+                "StackMapTable",
+                "Exceptions",
+                "InnerClasses",
+                "EnclosingMethod",
+                "Synthetic",
+                "Signature",
+                "SourceFile",
+                "SourceDebugExtension",
+                "LineNumberTable",
+                "LocalVariableTable",
+                "LocalVariableTypeTable",
+                "Deprecated",
+                "RuntimeVisibleAnnotations",
+                "RuntimeInvisibleAnnotations",
+                "RuntimeVisibleParameterAnnotations",
+                "RuntimeInvisibleParameterAnnotations",
+                "AnnotationDefault",
+                "BootstrapMethods"
+        };
 
-        static AttributeNameTag getAttributeNameTag(const std::string& attributeName) {
-            return attributeNameTagMap[attributeName];
-        }
+        // A perfect hash over attributeNames: one hash and one string comparison, no shared state
+        static constexpr AttributeNameTag getAttributeNameTag(std::string_view attributeName);
 
         void setAttributeName(std::string name) {
             attributeName = std::move(name);
@@ -75,16 +118,88 @@ namespace jvmg {
     private:
         void _serialize() override {
             serializeBytes(attributeNameIndex);
-            serializeBytes(attributeLength);
-            insertBytes(info->serialize());
+            attributeLength = serializeChildWithLength(*info);
         }
+        [[nodiscard]] bool contentsUnchanged() const override;
         std::string attributeName;
     };
 
+    // True if attributes holds as many attributes as when count was last read or written, and none has changed
+    inline bool attributesUnchanged(std::uint16_t count, const std::vector<AttributeInfo*> &attributes) {
+        if (attributes.size() != count) {
+            return false;
+        }
+        for (auto *attribute : attributes) {
+            if (!attribute->isUnchanged()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    namespace detail {
+        constexpr std::size_t ATTRIBUTE_NAME_SLOTS = 64;
+
+        // Mixes the length and three characters, which is enough to tell the known names apart
+        constexpr std::size_t hashAttributeName(std::string_view name, std::uint32_t seed) {
+            std::uint32_t hash = static_cast<std::uint32_t>(name.size()) * seed;
+            for (auto c : {name.front(), name[name.size() / 2], name.back()}) {
+                hash = (hash ^ static_cast<std::uint8_t>(c)) * 0x01000193;
+            }
+            return (hash >> 16) % ATTRIBUTE_NAME_SLOTS;
+        }
+
+        // The first seed for which no two known names share a slot
+        consteval std::uint32_t findAttributeNameSeed() {
+            for (std::uint32_t seed = 1; seed < 100000; seed++) {
+                std::array<bool, ATTRIBUTE_NAME_SLOTS> used{};
+                bool collision = false;
+                for (auto name : AttributeInfo::attributeNames) {
+                    auto slot = hashAttributeName(name, seed);
+                    collision = collision || used[slot];
+                    used[slot] = true;
+                }
+                if (!collision) {
+                    return seed;
+                }
+            }
+            return 0;
+        }
+
+        inline constexpr std::uint32_t attributeNameSeed = findAttributeNameSeed();
+        static_assert(attributeNameSeed != 0, "No collision-free seed for the attribute names");
+
+        consteval std::array<AttributeInfo::AttributeNameTag, ATTRIBUTE_NAME_SLOTS> makeAttributeNameSlots() {
+            std::array<AttributeInfo::AttributeNameTag, ATTRIBUTE_NAME_SLOTS> slots{};
+            slots.fill(AttributeInfo::UNKNOWN);
+            for (std::size_t tag = 0; tag < AttributeInfo::attributeNames.size(); tag++) {
+                slots[hashAttributeName(AttributeInfo::attributeNames[tag], attributeNameSeed)] =
+                        static_cast<AttributeInfo::AttributeNameTag>(tag);
+            }
+            return slots;
+        }
+
+        inline constexpr auto attributeNameSlots = makeAttributeNameSlots();
+    }
+
+    constexpr AttributeInfo::AttributeNameTag AttributeInfo::getAttributeNameTag(std::string_view attributeName) {
+        if (attributeName.empty()) {
+            return UNKNOWN;
+        }
+        auto tag = detail::attributeNameSlots[detail::hashAttributeName(attributeName, detail::attributeNameSeed)];
+        return tag != UNKNOWN && attributeNames[tag] == attributeName ? tag : UNKNOWN;
+    }
+
+    static_assert(AttributeInfo::getAttributeNameTag("Code") == AttributeInfo::CODE);
+    static_assert(AttributeInfo::getAttributeNameTag("RuntimeVisibleParameterAnnotations") == AttributeInfo::RUNTIME_VISIBLE_PARAMETER_ANNOTATIONS);
+    static_assert(AttributeInfo::getAttributeNameTag("Cod") == AttributeInfo::UNKNOWN);
+
     struct ConstantValueAttribute : public Attribute {
         explicit ConstantValueAttribute(std::uint16_t constantValueIndex) : constantValueIndex(constantValueIndex) {}
 
         std::uint16_t constantValueIndex;
+
+        [[nodiscard]] bool matchesInfo(std::span<const std::uint8_t> info) const override;
     private:
         void _serialize() override {
             serializeBytes(constantValueIndex);
@@ -119,7 +234,7 @@ namespace jvmg {
         CodeAttribute(std::uint16_t maxStack,
                       std::uint16_t maxLocals,
                       std::uint32_t codeLength,
-                      std::vector<Instruction> code,
+                      InstructionStream code,
                       std::uint16_t exceptionTableLength,
                       std::vector<ExceptionTableEntry> exceptionTable,
                       std::uint16_t attributesCount,
@@ -133,6 +248,27 @@ namespace jvmg {
         attributesCount(attributesCount),
         attributes(std::move(attributes)) {}
 
+        // Lazily decoded Code attribute: body holds everything after code_length (the code array, exception
+        // table and nested attributes), kept alive by bodyOwner as for RawAttribute. On first access decoder
+        // fills in the code, exceptionTable and attributes of the attribute it is given.
+        using Decoder = std::function<void(CodeAttribute &into, std::span<const std::uint8_t> body,
+                                           const std::shared_ptr<const void> &bodyOwner)>;
+
+        CodeAttribute(std::uint16_t maxStack,
+                      std::uint16_t maxLocals,
+                      std::uint32_t codeLength,
+                      std::span<const std::uint8_t> body,
+                      std::shared_ptr<const void> bodyOwner,
+                      Decoder decoder)
+        : maxStack(maxStack),
+        maxLocals(maxLocals),
+        codeLength(codeLength),
+        exceptionTableLength(0),
+        attributesCount(0),
+        body(body),
+        bodyOwner(std::move(bodyOwner)),
+        decoder(std::move(decoder)) {}
+
         ~CodeAttribute() override {
             for (auto attribute : attributes) {
                 delete attribute;
@@ -140,17 +276,67 @@ namespace jvmg {
             attributes.clear();
         }
 
+        // These decode a lazily parsed attribute on first use, and are safe to call from several threads at once.
+        // The non-const ones count as changing the attribute, so a class parsed with
+        // ParseOptions::COPY_UNCHANGED writes it from the tree afterwards.
+        InstructionStream &getCode() { decode(); markModified(); return code; }
+        std::vector<ExceptionTableEntry> &getExceptionTable() { decode(); markModified(); return exceptionTable; }
+        std::vector<AttributeInfo*> &getAttributes() { decode(); markModified(); return attributes; }
+        [[nodiscard]] const InstructionStream &getCode() const { decodeConst(); return code; }
+        [[nodiscard]] const std::vector<ExceptionTableEntry> &getExceptionTable() const { decodeConst(); return exceptionTable; }
+        [[nodiscard]] const std::vector<AttributeInfo*> &getAttributes() const { decodeConst(); return attributes; }
+
+        [[nodiscard]] bool isDecoded() const { return !decoder || decoded; }
+
+        [[nodiscard]] bool matchesInfo(std::span<const std::uint8_t> info) const override;
+
+        // Raw bytes of a lazily parsed attribute; empty once decoded
+        [[nodiscard]] std::span<const std::uint8_t> getBody() const { return body; }
+        // Keeps getBody() alive for nested attributes that point into it
+        [[nodiscard]] const std::shared_ptr<const void> &getBodyOwner() const { return bodyOwner; }
+
+        // Decodes into a scratch attribute and only takes its contents on success, so a decode that throws leaves
+        // this one as it was and the next access tries again
+        void decode() {
+            if (decoder) {
+                std::call_once(decodeOnce, [this] {
+                    CodeAttribute decodedCode(maxStack, maxLocals, codeLength, {}, 0, {}, 0, {});
+                    decoder(decodedCode, body, bodyOwner);
+                    code = std::move(decodedCode.code);
+                    exceptionTableLength = decodedCode.exceptionTableLength;
+                    exceptionTable = std::move(decodedCode.exceptionTable);
+                    attributesCount = decodedCode.attributesCount;
+                    attributes = std::exchange(decodedCode.attributes, {});
+                    decoded = true;
+                    body = {};
+                    bodyOwner.reset();
+                });
+            }
+        }
+
         std::uint16_t maxStack;
         std::uint16_t maxLocals;
         std::uint32_t codeLength;
-        std::vector<Instruction> code;
         std::uint16_t exceptionTableLength;
-        std::vector<ExceptionTableEntry> exceptionTable;
         std::uint16_t attributesCount;
-        std::vector<AttributeInfo*> attributes;
 
     private:
+        // The parser fills in what it decodes without that counting as a change
+        friend class Parser;
+
         void _serialize() override;
+        // Decoding fills in what the attribute already stood for, so it is allowed through a const accessor
+        void decodeConst() const { const_cast<CodeAttribute *>(this)->decode(); }
+
+        std::span<const std::uint8_t> body;
+        std::shared_ptr<const void> bodyOwner;
+        Decoder decoder;
+        std::once_flag decodeOnce;
+        std::atomic<bool> decoded = false;
+
+        InstructionStream code;
+        std::vector<ExceptionTableEntry> exceptionTable;
+        std::vector<AttributeInfo*> attributes;
     };
 
     struct StackMapTable : public Attribute {
@@ -162,9 +348,9 @@ namespace jvmg {
         std::vector<StackMapFrameEntry> stackMapFrame;
     private:
         void _serialize() override {
-            serializeBytes(numberOfEntries);
+            serializeCount(numberOfEntries, stackMapFrame.size());
             for (auto& entry : stackMapFrame) {
-                insertBytes(entry.serialize());
+                serializeChild(entry);
             }
         }
     };
@@ -191,16 +377,21 @@ namespace jvmg {
                 : lineNumberTableLength(lineNumberTableLength),
                 lineNumberTable(std::move(lineNumberTable)) {}
 
+        // The non-const accessor counts as changing the attribute, as for CodeAttribute
+        std::vector<LineNumberTableEntry> &getLineNumberTable() { markModified(); return lineNumberTable; }
+        [[nodiscard]] const std::vector<LineNumberTableEntry> &getLineNumberTable() const { return lineNumberTable; }
+
         std::uint16_t lineNumberTableLength;
-        std::vector<LineNumberTableEntry> lineNumberTable;
 
     private:
         void _serialize() override {
-            serializeBytes(lineNumberTableLength);
+            serializeCount(lineNumberTableLength, lineNumberTable.size());
             for (auto& lineNumberTableEntry : lineNumberTable) {
-                insertBytes(lineNumberTableEntry.serialize());
+                serializeChild(lineNumberTableEntry);
             }
         }
+
+        std::vector<LineNumberTableEntry> lineNumberTable;
     };
 
     class SourceFileAttribute : public Attribute {
@@ -209,6 +400,8 @@ namespace jvmg {
         ~SourceFileAttribute() override = default;
 
         std::uint16_t sourceFileIndex;
+
+        [[nodiscard]] bool matchesInfo(std::span<const std::uint8_t> info) const override;
     private:
         void _serialize() override {
             serializeBytes(sourceFileIndex);
@@ -217,5 +410,26 @@ namespace jvmg {
         std::string sourceFileName;
     };
 
+    // Any attribute without a model of its own: its info bytes are kept as they were read and written back
+    // verbatim. bytes points into the parser's input, which owner keeps alive; owner is null when the caller
+    // guarantees the input outlives the attribute.
+    struct RawAttribute : public Attribute {
+        RawAttribute(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner)
+            : bytes(bytes), owner(std::move(owner)) {}
+
+        std::span<const std::uint8_t> bytes;
+
+        // Still the bytes that were read, rather than equal ones
+        [[nodiscard]] bool matchesInfo(std::span<const std::uint8_t> info) const override {
+            return bytes.data() == info.data() && bytes.size() == info.size();
+        }
+    private:
+        void _serialize() override {
+            insertBytes(bytes);
+        }
+
+        std::shared_ptr<const void> owner;
+    };
+
 }
 #endif //_ATTRIBUTE_H
@@ -0,0 +1,46 @@
+//
+// Created by Micky on 2/13/2024.
+//
+
+#ifndef _CLASS_HEADER_H
+#define _CLASS_HEADER_H
+
+#include "jvmg/IR/ConstantPool/constantPool.h"
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace jvmg {
+    // What a class declares, without any attributes: enough to build a classpath index.
+    // Produced by Parser::consumeClassHeader().
+    struct ClassHeader {
+        struct Member {
+            std::uint16_t accessFlags;
+            std::uint16_t nameIndex;
+            std::uint16_t descriptorIndex;
+        };
+
+        std::uint16_t minorVersion = 0;
+        std::uint16_t majorVersion = 0;
+        std::shared_ptr<const ConstantPool> constantPool;
+        std::uint16_t accessFlags = 0;
+        std::uint16_t thisClass = 0;
+        std::uint16_t superClass = 0;
+        std::vector<std::uint16_t> interfaces;
+        std::vector<Member> fields;
+        std::vector<Member> methods;
+
+        [[nodiscard]] std::string_view getClassName(std::uint16_t classIndex) const {
+            return constantPool->utf8(constantPool->classNameIndex(classIndex));
+        }
+        [[nodiscard]] std::string_view getThisClassName() const { return getClassName(thisClass); }
+        // Empty for java/lang/Object, which has no superclass
+        [[nodiscard]] std::string_view getSuperClassName() const { return superClass == 0 ? std::string_view() : getClassName(superClass); }
+        [[nodiscard]] std::string_view getName(const Member &member) const { return constantPool->utf8(member.nameIndex); }
+        [[nodiscard]] std::string_view getDescriptor(const Member &member) const { return constantPool->utf8(member.descriptorIndex); }
+    };
+}
+
+#endif //_CLASS_HEADER_H
@@ -8,9 +8,10 @@
 #define CLASS_MAGIC 0xCAFEBABE
 
 #include "jvmg/IR/attribute.h"
-#include "jvmg/IR/ConstantPool/constantPoolInfo.h"
+#include "jvmg/IR/ConstantPool/constantPool.h"
 
 #include <cstdint>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -28,7 +29,7 @@ namespace jvmg {
             ACC_ENUM = 0x4000
         };
 
-        struct FieldInfo : Serializable {
+        struct FieldInfo : SourceBacked {
         public:
             enum FieldAccessFlag : std::uint16_t {
                 ACC_PUBLIC = 0x0001,
@@ -60,9 +61,13 @@ namespace jvmg {
             std::vector<AttributeInfo*> attributes;
         private:
             void _serialize() override;
+            [[nodiscard]] bool contentsUnchanged() const override {
+                return sourceU2(0) == accessFlags && sourceU2(2) == nameIndex && sourceU2(4) == descriptorIndex
+                       && attributesUnchanged(attributesCount, attributes);
+            }
         };
 
-        struct MethodInfo : public Serializable {
+        struct MethodInfo : public SourceBacked {
         public:
             enum MethodAccessFlags : uint16_t {
                 ACC_PUBLIC = 0x0001,
@@ -99,10 +104,14 @@ namespace jvmg {
 
         private:
             void _serialize() override;
+            [[nodiscard]] bool contentsUnchanged() const override {
+                return sourceU2(0) == accessFlags && sourceU2(2) == nameIndex && sourceU2(4) == descriptorIndex
+                       && attributesUnchanged(attributesCount, attributes);
+            }
         };
 
         ClassFile(const std::uint16_t &minorVersion, const std::uint16_t &majorVersion,
-                  const std::uint16_t &constantPoolCount, std::vector<CPInfo> constantPool, const std::uint16_t &accessFlags,
+                  const std::uint16_t &constantPoolCount, std::shared_ptr<ConstantPool> constantPool, const std::uint16_t &accessFlags,
                   const std::uint16_t &thisClass, const std::uint16_t &superClass, const std::uint16_t &interfaceCount,
                   std::vector<std::uint16_t> interfaces, const std::uint16_t &fieldsCount, std::vector<FieldInfo> fields,
                   const std::uint16_t &methodCount, std::vector<MethodInfo> methods, const std::uint16_t &attributesCount,
@@ -114,37 +123,68 @@ namespace jvmg {
                                                             methods(std::move(methods)), attributesCount(attributesCount),
                                                             attributes(std::move(attributes)) {}
 
+        // The class owns its attributes, so it can be moved but not copied
+        ClassFile(const ClassFile&) = delete;
+        ClassFile& operator=(const ClassFile&) = delete;
+
+        ClassFile(ClassFile&& other) noexcept
+            : minorVersion(other.minorVersion), majorVersion(other.majorVersion),
+              constantPoolCount(other.constantPoolCount), constantPool(std::move(other.constantPool)),
+              accessFlags(other.accessFlags), thisClass(other.thisClass), superClass(other.superClass),
+              interfaceCount(other.interfaceCount), interfaces(std::move(other.interfaces)),
+              fieldsCount(other.fieldsCount), fields(std::move(other.fields)), methodsCount(other.methodsCount),
+              methods(std::move(other.methods)), attributesCount(other.attributesCount),
+              attributes(std::move(other.attributes)) {
+            other.fields.clear();
+            other.methods.clear();
+            other.attributes.clear();
+        }
+
+        // Frees the attributes of the class and of every field and method. Copies of a FieldInfo or MethodInfo
+        // share its attribute pointers, so they must not outlive the class.
         ~ClassFile() {
-            for (auto attribute : attributes) {
-                delete attribute;
+            for (auto &field : fields) {
+                deleteAll(field.attributes);
             }
-            attributes.clear();
+            for (auto &method : methods) {
+                deleteAll(method.attributes);
+            }
+            deleteAll(attributes);
         }
 
         [[nodiscard]] std::uint16_t getMinorVersion() const { return minorVersion; }
         [[nodiscard]] std::uint16_t getMajorVersion() const { return majorVersion; }
-        [[nodiscard]] std::uint16_t getConstantPoolCount() const { return constantPoolCount; }
-        [[nodiscard]] const std::vector<CPInfo>& getConstantPool() const { return constantPool; }
+        // The counts follow the contents; the values passed to the constructor are only kept until serialize()
+        [[nodiscard]] std::uint16_t getConstantPoolCount() const { return constantPool->getCount(); }
+        [[nodiscard]] const ConstantPool& getConstantPool() const { return *constantPool; }
         [[nodiscard]] std::uint16_t getAccessFlags() const { return accessFlags; }
         [[nodiscard]] std::uint16_t getThisClass() const { return thisClass; }
         [[nodiscard]] std::uint16_t getSuperClass() const { return superClass; }
-        [[nodiscard]] std::uint16_t getInterfaceCount() const { return interfaceCount; }
+        [[nodiscard]] std::uint16_t getInterfaceCount() const { return static_cast<std::uint16_t>(interfaces.size()); }
         [[nodiscard]] const std::vector<std::uint16_t>& getInterfaces() const { return interfaces; }
-        [[nodiscard]] std::uint16_t getMethodsCount() const { return methodsCount; }
+        [[nodiscard]] std::uint16_t getMethodsCount() const { return static_cast<std::uint16_t>(methods.size()); }
         [[nodiscard]] const std::vector<MethodInfo>& getMethods() const { return methods; }
-        [[nodiscard]] std::uint16_t getFieldsCount() const { return fieldsCount; }
+        [[nodiscard]] std::uint16_t getFieldsCount() const { return static_cast<std::uint16_t>(fields.size()); }
         [[nodiscard]] const std::vector<FieldInfo>& getFields() const { return fields; }
-        [[nodiscard]] std::uint16_t getAttributesCount() const { return attributesCount; }
+        [[nodiscard]] std::uint16_t getAttributesCount() const { return static_cast<std::uint16_t>(attributes.size()); }
         [[nodiscard]] const std::vector<AttributeInfo*>& getAttributes() const { return attributes; }
 
         const std::uint32_t magic = CLASS_MAGIC;
     private:
         void _serialize() override;
 
+        static void deleteAll(std::vector<AttributeInfo*> &list) {
+            for (auto *attribute : list) {
+                delete attribute;
+            }
+            list.clear();
+        }
+
         std::uint16_t minorVersion;
         std::uint16_t majorVersion;
         std::uint16_t constantPoolCount;
-        std::vector<CPInfo> constantPool;
+        // Shared with the parser that produced the class, which may still need it to decode lazily parsed attributes
+        std::shared_ptr<ConstantPool> constantPool;
         std::uint16_t accessFlags;
         std::uint16_t thisClass;
         std::uint16_t superClass;
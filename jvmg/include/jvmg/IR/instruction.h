@@ -294,7 +294,7 @@ namespace jvmg {
         }
 
         InstructionShortOperand(std::uint8_t opcodeByte, std::uint16_t operand, Type type) : InstructionShortOperand(opcodeByte, operand) {
-            type = type;
+            this->type = type;
         }
     };
 
@@ -337,7 +337,7 @@ namespace jvmg {
     };
 
     struct SiPush : public InstructionShortOperand {
-        explicit SiPush(std::uint16_t operand) : InstructionShortOperand(0x11, operand, ByteTy) {}
+        explicit SiPush(std::uint16_t operand) : InstructionShortOperand(0x11, operand, ShortTy) {}
     };
 
     struct Ldc : public InstructionByteOperand {
@@ -400,7 +400,7 @@ namespace jvmg {
     static const Instruction ALoad0(0x2A, Instruction::ReferenceTy, Instruction::ZERO);
     static const Instruction ALoad1(0x2B, Instruction::ReferenceTy, Instruction::ONE);
     static const Instruction ALoad2(0x2C, Instruction::ReferenceTy, Instruction::TWO);
-    static const Instruction ALoad3(0x2D, Instruction::ReferenceTy, Instruction::TWO);
+    static const Instruction ALoad3(0x2D, Instruction::ReferenceTy, Instruction::THREE);
 
     // Taload_<n>
     static const Instruction IALoad(0x2E, Instruction::IntTy);
@@ -635,8 +635,8 @@ namespace jvmg {
         explicit Jsr(std::uint16_t operand) : InstructionShortOperand(0xA8, operand) {}
     };
 
-    struct Ret : InstructionShortOperand {
-        explicit Ret(std::uint8_t operand) : InstructionShortOperand(0xA9, operand) {}
+    struct Ret : InstructionByteOperand {
+        explicit Ret(std::uint8_t operand) : InstructionByteOperand(0xA9, operand) {}
     };
 
     class Tableswitch : public Instruction {
@@ -692,7 +692,7 @@ namespace jvmg {
 
             for (auto pair : pairs) {
                 auto match = pair.first;
-                auto offset = pair.first;
+                auto offset = pair.second;
 
                 operands.push_back((match & 0xFF000000) >> 24);
                 operands.push_back((match & 0xFF0000) >> 16);
@@ -795,11 +795,11 @@ namespace jvmg {
     };
 
     struct IfNull : InstructionShortOperand {
-        explicit IfNull(std::uint8_t operand) : InstructionShortOperand(0xC6, operand) {}
+        explicit IfNull(std::uint16_t operand) : InstructionShortOperand(0xC6, operand) {}
     };
 
     struct IfNonNull : InstructionShortOperand {
-        explicit IfNonNull(std::uint8_t operand) : InstructionShortOperand(0xC7, operand) {}
+        explicit IfNonNull(std::uint16_t operand) : InstructionShortOperand(0xC7, operand) {}
     };
 
     struct GotoW : InstructionIntOperand {
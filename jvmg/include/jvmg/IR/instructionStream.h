@@ -0,0 +1,130 @@
+//
+// Created by Micky on 2/11/2024.
+//
+
+#ifndef _INSTRUCTION_STREAM_H
+#define _INSTRUCTION_STREAM_H
+
+#include "jvmg/IR/instruction.h"
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace jvmg {
+    // One instruction inside an InstructionStream or a code array. Cheap to copy; only valid while the bytes it was
+    // decoded from are unchanged.
+    class InstructionView {
+    public:
+        InstructionView(std::uint8_t opcodeByte, std::uint32_t bci, std::int32_t operand, std::span<const std::uint8_t> operands)
+            : opcodeByte(opcodeByte), bci(bci), operand(operand), operands(operands) {}
+
+        // Decodes the instruction at bci straight from a code array. Empty for an undefined opcode, a malformed
+        // switch, or an instruction that runs past the end of code.
+        static std::optional<InstructionView> decode(std::span<const std::uint8_t> code, std::uint32_t bci);
+
+        [[nodiscard]] std::uint8_t getOpcodeByte() const { return opcodeByte; }
+        [[nodiscard]] Instruction::Opcode getOpcode() const { return Instruction::getOpcodeFromOpcodeByte(opcodeByte); }
+        // Offset of the opcode from the start of the code array
+        [[nodiscard]] std::uint32_t getBci() const { return bci; }
+        // The first operand decoded: the index, constant or branch offset; the default offset for switches
+        [[nodiscard]] std::int32_t getOperand() const { return operand; }
+        // Raw operand bytes, including switch padding
+        [[nodiscard]] std::span<const std::uint8_t> getOperands() const { return operands; }
+        [[nodiscard]] std::size_t getSizeInBytes() const { return 1 + operands.size(); }
+        [[nodiscard]] Instruction::Type getType() const;
+        [[nodiscard]] std::optional<Instruction::ImplicitValue> getImplicitValue() const;
+
+        // Copies the instruction out into a standalone Instruction
+        [[nodiscard]] Instruction toInstruction() const;
+
+    private:
+        std::uint8_t opcodeByte;
+        std::uint32_t bci;
+        std::int32_t operand;
+        std::span<const std::uint8_t> operands;
+    };
+
+    // The instructions of a code array, stored as parallel arrays: opcodes, byte offsets (bcis), and the first
+    // operand of each instruction decoded to a word, next to the raw code bytes. Scans over getOpcodes() or
+    // getOperandWords() touch one small array each.
+    class InstructionStream {
+    public:
+        // Random access over the index. Dereferencing yields an InstructionView by value, so to pre-C++20
+        // algorithms this is only an input iterator.
+        class Iterator {
+        public:
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::input_iterator_tag;
+            using value_type = InstructionView;
+            using difference_type = std::ptrdiff_t;
+
+            Iterator() = default;
+            Iterator(const InstructionStream *stream, std::size_t index) : stream(stream), index(index) {}
+
+            InstructionView operator*() const { return (*stream)[index]; }
+            InstructionView operator[](difference_type offset) const { return (*stream)[index + offset]; }
+
+            Iterator &operator++() { index++; return *this; }
+            Iterator operator++(int) { auto copy = *this; index++; return copy; }
+            Iterator &operator--() { index--; return *this; }
+            Iterator operator--(int) { auto copy = *this; index--; return copy; }
+            Iterator &operator+=(difference_type offset) { index += offset; return *this; }
+            Iterator &operator-=(difference_type offset) { index -= offset; return *this; }
+            Iterator operator+(difference_type offset) const { return {stream, index + offset}; }
+            Iterator operator-(difference_type offset) const { return {stream, index - offset}; }
+            friend Iterator operator+(difference_type offset, const Iterator &iterator) { return iterator + offset; }
+            difference_type operator-(const Iterator &other) const {
+                return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+            }
+
+            bool operator==(const Iterator &other) const { return index == other.index; }
+            auto operator<=>(const Iterator &other) const { return index <=> other.index; }
+
+        private:
+            const InstructionStream *stream = nullptr;
+            std::size_t index = 0;
+        };
+
+        InstructionStream() = default;
+
+        // Builds a stream from standalone instructions, laid out back to back from bci 0
+        InstructionStream(const std::vector<Instruction>& instructions);
+
+        void reserve(std::size_t instructionCount, std::size_t codeLength);
+
+        // Appends an instruction at the current end of the code array
+        void append(std::uint8_t opcodeByte, std::span<const std::uint8_t> operands);
+        void append(const Instruction& instruction);
+
+        [[nodiscard]] std::size_t size() const { return opcodes.size(); }
+        [[nodiscard]] bool empty() const { return opcodes.empty(); }
+        [[nodiscard]] std::size_t getCodeLength() const { return code.size(); }
+
+        [[nodiscard]] InstructionView operator[](std::size_t index) const;
+
+        // Index of the instruction starting at bci, if there is one
+        [[nodiscard]] std::optional<std::size_t> indexOfBci(std::uint32_t bci) const;
+
+        [[nodiscard]] std::span<const std::uint8_t> getOpcodes() const { return opcodes; }
+        [[nodiscard]] std::span<const std::uint32_t> getBcis() const { return bcis; }
+        [[nodiscard]] std::span<const std::int32_t> getOperandWords() const { return operandWords; }
+        // The code array exactly as it appears in the class file
+        [[nodiscard]] std::span<const std::uint8_t> getBytes() const { return code; }
+
+        [[nodiscard]] Iterator begin() const { return {this, 0}; }
+        [[nodiscard]] Iterator end() const { return {this, size()}; }
+
+    private:
+        std::vector<std::uint8_t> opcodes;
+        std::vector<std::uint32_t> bcis;
+        std::vector<std::int32_t> operandWords;
+        std::vector<std::uint8_t> code;
+    };
+
+    static_assert(std::random_access_iterator<InstructionStream::Iterator>);
+}
+
+#endif //_INSTRUCTION_STREAM_H
@@ -0,0 +1,152 @@
+//
+// Created by Micky on 2/10/2024.
+//
+
+#ifndef _OPCODE_TABLE_H
+#define _OPCODE_TABLE_H
+
+#include "jvmg/IR/instruction.h"
+
+#include <array>
+#include <cstdint>
+
+namespace jvmg {
+    // How an opcode's operands are laid out in the code array
+    struct OpcodeFormat {
+        enum Layout : std::uint8_t {
+            INVALID = 0,
+            // operandBytes bytes follow the opcode
+            FIXED,
+            // 0-3 bytes of padding to a 4-byte boundary, then default, low, high and (high - low + 1) offsets
+            TABLESWITCH,
+            // 0-3 bytes of padding to a 4-byte boundary, then default, npairs and npairs match/offset pairs
+            LOOKUPSWITCH,
+            // The modified opcode, a 2-byte index, and a 2-byte constant if the modified opcode is iinc
+            WIDE
+        };
+
+        Layout layout = INVALID;
+        std::uint8_t operandBytes = 0;
+        Instruction::Type type = Instruction::NoTy;
+        bool hasImplicitValue = false;
+        Instruction::ImplicitValue implicitValue = Instruction::NULL_VAL;
+        // Width of the first operand (the index, constant or branch offset), which may be shorter than operandBytes
+        std::uint8_t firstOperandBytes = 0;
+        bool firstOperandSigned = false;
+    };
+
+    namespace detail {
+        constexpr void setFixed(std::array<OpcodeFormat, 256> &formats, std::uint8_t first, std::uint8_t last,
+                                std::uint8_t operandBytes, Instruction::Type type = Instruction::NoTy) {
+            for (int opcode = first; opcode <= last; opcode++) {
+                formats[opcode] = {OpcodeFormat::FIXED, operandBytes, type};
+                formats[opcode].firstOperandBytes = operandBytes;
+            }
+        }
+
+        // Consecutive opcodes that only differ in the type they operate on, in the JVM's usual i, l, f, d, a order
+        constexpr void setTyped(std::array<OpcodeFormat, 256> &formats, std::uint8_t first, std::uint8_t operandBytes,
+                                std::initializer_list<Instruction::Type> types) {
+            int opcode = first;
+            for (auto type : types) {
+                formats[opcode] = {OpcodeFormat::FIXED, operandBytes, type};
+                formats[opcode++].firstOperandBytes = operandBytes;
+            }
+        }
+
+        // <op>_<n> shorthands, one group of count opcodes per type
+        constexpr void setImplicit(std::array<OpcodeFormat, 256> &formats, std::uint8_t first, Instruction::ImplicitValue firstValue,
+                                   std::uint8_t count, std::initializer_list<Instruction::Type> types, bool hasImplicitValue = true) {
+            int opcode = first;
+            for (auto type : types) {
+                for (int i = 0; i < count; i++) {
+                    formats[opcode++] = {OpcodeFormat::FIXED, 0, type, hasImplicitValue,
+                                         static_cast<Instruction::ImplicitValue>(firstValue + i)};
+                }
+            }
+        }
+
+        constexpr std::array<OpcodeFormat, 256> makeOpcodeFormats() {
+            using enum Instruction::Type;
+            std::array<OpcodeFormat, 256> formats{};
+
+            setFixed(formats, Instruction::NOP, Instruction::NOP, 0);
+            formats[Instruction::ACONST_NULL] = {OpcodeFormat::FIXED, 0, ReferenceTy, true, Instruction::NULL_VAL};
+            setImplicit(formats, Instruction::ICONST_M1, Instruction::M1, 7, {IntTy});
+            setImplicit(formats, Instruction::LCONST_0, Instruction::ZERO, 2, {LongTy});
+            setImplicit(formats, Instruction::FCONST_0, Instruction::ZERO, 3, {FloatTy});
+            setImplicit(formats, Instruction::DCONST_0, Instruction::ZERO, 2, {DoubleTy});
+            setFixed(formats, Instruction::BIPUSH, Instruction::BIPUSH, 1, ByteTy);
+            setFixed(formats, Instruction::SIPUSH, Instruction::SIPUSH, 2, ShortTy);
+            setFixed(formats, Instruction::LDC, Instruction::LDC, 1);
+            setFixed(formats, Instruction::LDC_W, Instruction::LDC2_W, 2);
+
+            setTyped(formats, Instruction::ILOAD, 1, {IntTy, LongTy, FloatTy, DoubleTy, ReferenceTy});
+            setImplicit(formats, Instruction::ILOAD_0, Instruction::ZERO, 4, {IntTy, LongTy, FloatTy, DoubleTy, ReferenceTy});
+            setTyped(formats, Instruction::IALOAD, 0, {IntTy, LongTy, FloatTy, DoubleTy, ReferenceTy, ByteTy, CharTy, ShortTy});
+            setTyped(formats, Instruction::ISTORE, 1, {IntTy, LongTy, FloatTy, DoubleTy, ReferenceTy});
+            setImplicit(formats, Instruction::ISTORE_0, Instruction::ZERO, 4, {IntTy, LongTy, FloatTy, DoubleTy, ReferenceTy}, false);
+            setTyped(formats, Instruction::IASTORE, 0, {IntTy, LongTy, FloatTy, DoubleTy, ReferenceTy, ByteTy, CharTy, ShortTy});
+
+            // Stack manipulation, arithmetic, conversions and comparisons
+            setFixed(formats, Instruction::POP, Instruction::LXOR, 0);
+            setFixed(formats, Instruction::IINC, Instruction::IINC, 2);
+            setFixed(formats, Instruction::I2L, Instruction::DCMPG, 0);
+
+            // Branches
+            setFixed(formats, Instruction::IFEQ, Instruction::JSR, 2);
+            setFixed(formats, Instruction::RET, Instruction::RET, 1);
+            formats[Instruction::TABLESWITCH] = {OpcodeFormat::TABLESWITCH};
+            formats[Instruction::LOOKUPSWITCH] = {OpcodeFormat::LOOKUPSWITCH};
+
+            setTyped(formats, Instruction::IRETURN, 0, {IntTy, LongTy, FloatTy, DoubleTy, ReferenceTy});
+            setFixed(formats, Instruction::RETURN, Instruction::RETURN, 0);
+
+            // Fields, calls and objects
+            setFixed(formats, Instruction::GETSTATIC, Instruction::INVOKESTATIC, 2);
+            setFixed(formats, Instruction::INVOKEINTERFACE, Instruction::INVOKEDYNAMIC, 4);
+            setFixed(formats, Instruction::NEW, Instruction::NEW, 2);
+            setFixed(formats, Instruction::NEWARRAY, Instruction::NEWARRAY, 1);
+            setFixed(formats, Instruction::ANEWARRAY, Instruction::ANEWARRAY, 2);
+            setFixed(formats, Instruction::ARRAYLENGTH, Instruction::ATHROW, 0);
+            setFixed(formats, Instruction::CHECKCAST, Instruction::INSTANCEOF, 2);
+            setFixed(formats, Instruction::MONITORENTER, Instruction::MONITOREXIT, 0);
+            formats[Instruction::WIDE] = {OpcodeFormat::WIDE};
+            setFixed(formats, Instruction::MULTIANEWARRAY, Instruction::MULTIANEWARRAY, 3);
+            setFixed(formats, Instruction::IFNULL, Instruction::IFNONNULL, 2);
+            setFixed(formats, Instruction::GOTO_W, Instruction::JSR_W, 4);
+
+            // Reserved
+            setFixed(formats, Instruction::BREAKPOINT, Instruction::BREAKPOINT, 0);
+            setFixed(formats, 0xFE, 0xFF, 0);
+
+            // Operands that are not a single index
+            formats[Instruction::IINC].firstOperandBytes = 1;
+            formats[Instruction::INVOKEINTERFACE].firstOperandBytes = 2;
+            formats[Instruction::INVOKEDYNAMIC].firstOperandBytes = 2;
+            formats[Instruction::MULTIANEWARRAY].firstOperandBytes = 2;
+            for (int opcode : {Instruction::BIPUSH, Instruction::SIPUSH, Instruction::GOTO_W, Instruction::JSR_W,
+                               Instruction::IFNULL, Instruction::IFNONNULL}) {
+                formats[opcode].firstOperandSigned = true;
+            }
+            for (int opcode = Instruction::IFEQ; opcode <= Instruction::JSR; opcode++) {
+                formats[opcode].firstOperandSigned = true;
+            }
+
+            return formats;
+        }
+    }
+
+    // Indexed by opcode byte
+    inline constexpr std::array<OpcodeFormat, 256> opcodeFormats = detail::makeOpcodeFormats();
+
+    static_assert(opcodeFormats[0x00].layout == OpcodeFormat::FIXED && opcodeFormats[0x00].operandBytes == 0);
+    static_assert(opcodeFormats[0x2D].implicitValue == Instruction::THREE && opcodeFormats[0x2D].type == Instruction::ReferenceTy);
+    static_assert(opcodeFormats[0x83].operandBytes == 0 && opcodeFormats[0x84].operandBytes == 2);
+    static_assert(opcodeFormats[0xA9].operandBytes == 1 && opcodeFormats[0xC7].operandBytes == 2);
+    static_assert(opcodeFormats[0xB9].operandBytes == 4 && opcodeFormats[0xC5].operandBytes == 3);
+    static_assert(opcodeFormats[0xB9].firstOperandBytes == 2 && opcodeFormats[0xA7].firstOperandSigned);
+    static_assert(opcodeFormats[0xCB].layout == OpcodeFormat::INVALID && opcodeFormats[0xFD].layout == OpcodeFormat::INVALID);
+}
+
+#endif //_OPCODE_TABLE_H
@@ -0,0 +1,33 @@
+//
+// Created by Micky on 2/3/2024.
+//
+
+#ifndef _INFLATE_H
+#define _INFLATE_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace jvmg {
+    // Decoder for raw DEFLATE streams (RFC 1951), as stored in ZIP/JAR entries
+    class Inflater {
+    public:
+        // The most output DEFLATE can produce per input byte: a 258-byte match coded in 2 bits, rounded up
+        static constexpr std::size_t MAX_EXPANSION = 1032;
+
+        // Decompresses src into dst, which must already be sized to the exact uncompressed size.
+        // Throws std::runtime_error on malformed or truncated input, or if the output size does not match.
+        static void inflate(std::span<const std::uint8_t> src, std::span<std::uint8_t> dst);
+
+        // Convenience overload that leaves dst holding the uncompressedSize bytes of output, reusing its
+        // capacity. uncompressedSize comes from an archive and is not trusted: it is rejected if src could not
+        // expand to it, and dst grows with the output rather than being sized to it up front.
+        static void inflate(std::span<const std::uint8_t> src, std::vector<std::uint8_t> &dst, std::size_t uncompressedSize);
+    };
+
+    // CRC-32 (ISO-HDLC), as used by ZIP
+    std::uint32_t crc32(std::span<const std::uint8_t> bytes, std::uint32_t crc = 0);
+}
+
+#endif //_INFLATE_H
@@ -0,0 +1,72 @@
+//
+// Created by Micky on 2/3/2024.
+//
+
+#ifndef _JAR_READER_H
+#define _JAR_READER_H
+
+#include "jvmg/reader.h"
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace jvmg {
+    // Reads class entries out of a JAR (ZIP) archive without extracting it to disk.
+    // The central directory is indexed up front; entry data is only touched when it is read.
+    class JarReader {
+    public:
+        enum CompressionMethod : std::uint16_t {
+            STORED = 0,
+            DEFLATED = 8
+        };
+
+        struct Entry {
+            std::string name;
+            std::uint16_t flags;
+            std::uint16_t compressionMethod;
+            std::uint32_t crc32;
+            std::uint64_t compressedSize;
+            std::uint64_t uncompressedSize;
+            std::uint64_t localHeaderOffset;
+
+            [[nodiscard]] bool isClass() const { return name.ends_with(".class"); }
+        };
+
+        using ClassCallback = std::function<void(const Entry&, std::span<const std::uint8_t>)>;
+
+        explicit JarReader(const std::string& filename);
+
+        // Reads an archive already in memory; bytes must outlive the JarReader
+        explicit JarReader(std::span<const std::uint8_t> bytes);
+
+        JarReader(const JarReader&) = delete;
+        JarReader& operator=(const JarReader&) = delete;
+
+        ~JarReader();
+
+        [[nodiscard]] const std::vector<Entry>& getEntries() const { return entries; }
+
+        // Returns the uncompressed bytes of entry. Stored entries are returned in place; deflated entries are
+        // inflated into buffer, whose capacity is reused across calls. Safe to call concurrently with distinct buffers.
+        std::span<const std::uint8_t> readEntry(const Entry& entry, std::vector<std::uint8_t>& buffer) const;
+
+        // Calls callback with every .class entry in directory order, inflating into one reused buffer.
+        // Other resources are skipped without being decompressed. The span is only valid during the callback.
+        void forEachClass(const ClassCallback& callback);
+
+    private:
+        void readCentralDirectory();
+
+        Reader *reader;
+        std::vector<std::uint8_t> fileBytes;
+        std::span<const std::uint8_t> archive;
+
+        std::vector<Entry> entries;
+        std::vector<std::uint8_t> scratch;
+    };
+}
+
+#endif //_JAR_READER_H
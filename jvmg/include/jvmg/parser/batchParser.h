@@ -0,0 +1,54 @@
+//
+// Created by Micky on 2/5/2024.
+//
+
+#ifndef _BATCH_PARSER_H
+#define _BATCH_PARSER_H
+
+#include "jvmg/parser/parser.h"
+#include "jvmg/util/fileLoader.h"
+#include "jvmg/util/threadPool.h"
+
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace jvmg {
+    // Parses many class files concurrently, one Parser per input.
+    // Inputs are scheduled largest first and spread over a work-stealing pool so a few huge classes
+    // do not leave the other threads idle at the end of the batch.
+    class BatchParser {
+    public:
+        // Called from worker threads, in completion order rather than input order
+        using Callback = std::function<void(std::size_t index, ClassFile&& classFile)>;
+
+        explicit BatchParser(unsigned threadCount = std::thread::hardware_concurrency()) : pool(threadCount) {}
+
+        // Results are returned in input order. If any input fails to parse, the remaining inputs are still
+        // parsed and the first exception is rethrown afterwards.
+        std::vector<ClassFile> parseFiles(const std::vector<std::string>& filenames);
+        // The buffers must outlive the returned classes, whose unmodeled attributes point into them
+        std::vector<ClassFile> parseBuffers(const std::vector<std::span<const std::uint8_t>>& buffers);
+
+        // Streams each result to callback as soon as it is parsed instead of collecting them
+        void parseFiles(const std::vector<std::string>& filenames, const Callback& callback);
+        void parseBuffers(const std::vector<std::span<const std::uint8_t>>& buffers, const Callback& callback);
+
+        // Reads the files through loader and parses each one on the pool as soon as its bytes arrive,
+        // overlapping file I/O with parsing
+        std::vector<ClassFile> parseFiles(const std::vector<std::string>& filenames, FileLoader& loader);
+        void parseFiles(const std::vector<std::string>& filenames, FileLoader& loader, const Callback& callback);
+
+        [[nodiscard]] unsigned getThreadCount() const { return pool.getThreadCount(); }
+
+    private:
+        void run(const std::vector<std::size_t>& sizes, const std::function<ClassFile(std::size_t)>& parse,
+                 const Callback& callback);
+        std::vector<ClassFile> collect(std::size_t count, const std::function<void(const Callback&)>& parseAll);
+
+        ThreadPool pool;
+    };
+}
+
+#endif //_BATCH_PARSER_H
@@ -0,0 +1,60 @@
+//
+// Created by Micky on 2/12/2024.
+//
+
+#ifndef _CLASS_VISITOR_H
+#define _CLASS_VISITOR_H
+
+#include "jvmg/IR/instructionStream.h"
+#include "jvmg/IR/ConstantPool/constantPool.h"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace jvmg {
+    // Callbacks for Parser::consumeClassFile(ClassVisitor&), which reports a class file as it reads it instead of
+    // building a ClassFile. Every callback defaults to doing nothing. Names and descriptors are views into the
+    // constant pool, and byte spans point into the parser's input; neither may be kept past visitEnd() of the class.
+    class FieldVisitor {
+    public:
+        virtual ~FieldVisitor() = default;
+
+        // info is the attribute body after attribute_length, undecoded
+        virtual void visitAttribute(std::string_view /*name*/, std::span<const std::uint8_t> /*info*/) {}
+        virtual void visitEnd() {}
+    };
+
+    class MethodVisitor {
+    public:
+        virtual ~MethodVisitor() = default;
+
+        // Return false to skip the code array, exception table and nested attributes without decoding them
+        virtual bool visitCode(std::uint16_t /*maxStack*/, std::uint16_t /*maxLocals*/, std::uint32_t /*codeLength*/) { return true; }
+        virtual void visitInstruction(const InstructionView &/*instruction*/) {}
+        virtual void visitExceptionHandler(std::uint16_t /*startPC*/, std::uint16_t /*endPC*/, std::uint16_t /*handlerPC*/, std::uint16_t /*catchType*/) {}
+        // Attributes nested inside Code, such as LineNumberTable
+        virtual void visitCodeAttribute(std::string_view /*name*/, std::span<const std::uint8_t> /*info*/) {}
+        virtual void visitAttribute(std::string_view /*name*/, std::span<const std::uint8_t> /*info*/) {}
+        virtual void visitEnd() {}
+    };
+
+    class ClassVisitor {
+    public:
+        virtual ~ClassVisitor() = default;
+
+        // Called once the constant pool has been read; constantPool stays valid until visitEnd()
+        virtual void visit(std::uint16_t /*minorVersion*/, std::uint16_t /*majorVersion*/, const ConstantPool &/*constantPool*/,
+                           std::uint16_t /*accessFlags*/, std::uint16_t /*thisClass*/, std::uint16_t /*superClass*/) {}
+        virtual void visitInterface(std::uint16_t /*interfaceIndex*/) {}
+
+        // Return nullptr to skip the member's attributes
+        virtual FieldVisitor *visitField(std::uint16_t /*accessFlags*/, std::string_view /*name*/, std::string_view /*descriptor*/) { return nullptr; }
+        virtual MethodVisitor *visitMethod(std::uint16_t /*accessFlags*/, std::string_view /*name*/, std::string_view /*descriptor*/) { return nullptr; }
+
+        virtual void visitAttribute(std::string_view /*name*/, std::span<const std::uint8_t> /*info*/) {}
+        virtual void visitEnd() {}
+    };
+}
+
+#endif //_CLASS_VISITOR_H
@@ -0,0 +1,45 @@
+//
+// Created by Micky on 2/14/2024.
+//
+
+#ifndef _PARSE_ERROR_H
+#define _PARSE_ERROR_H
+
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <string_view>
+
+namespace jvmg {
+    // Why and where a class file failed to parse. Cheap to create: no allocation, no formatting.
+    struct ParseError {
+        enum Reason : std::uint8_t {
+            TRUNCATED,
+            BAD_MAGIC,
+            BAD_CONSTANT_TAG,
+            // A CONSTANT_Utf8 entry that is not modified UTF-8, when validation is on
+            BAD_UTF8,
+            // A name or descriptor index that is out of range or does not refer to a Utf8 entry, or a Long or
+            // Double entry whose second slot is past constant_pool_count
+            BAD_CONSTANT_INDEX,
+            // A length field outside the range the JVM allows, such as a code_length of 0 or above 65535
+            BAD_LENGTH,
+            // An undefined opcode or a malformed tableswitch/lookupswitch
+            BAD_INSTRUCTION
+        };
+
+        Reason reason;
+        // Bytes consumed from the start of the input when the error was detected
+        std::size_t offset;
+
+        [[nodiscard]] std::string_view getDescription() const;
+        [[nodiscard]] std::string toString() const;
+    };
+
+    // The exception the throwing entry points raise for error: std::out_of_range when the input is truncated,
+    // std::invalid_argument otherwise. Creating it does not throw.
+    std::exception_ptr makeParseException(const ParseError& error);
+    [[noreturn]] void throwParseError(const ParseError& error);
+}
+
+#endif //_PARSE_ERROR_H
@@ -6,60 +6,263 @@
 #define _PARSER_H
 
 #include "jvmg/reader.h"
-#include "jvmg/IR/instruction.h"
-#include "jvmg/IR/ConstantPool/constantPoolInfo.h"
+#include "jvmg/parser/classVisitor.h"
+#include "jvmg/parser/parseError.h"
+#include "jvmg/IR/attribute.h"
+#include "jvmg/IR/classHeader.h"
+#include "jvmg/IR/instructionStream.h"
+#include "jvmg/IR/ConstantPool/constantPool.h"
 
-#include <cassert>
+#include <expected>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <sstream>
+#include <vector>
 
 namespace jvmg {
+    class ThreadPool;
+
+    // Bits for Parser::setOptions, combined with |
+    struct ParseOptions {
+        enum : std::uint32_t {
+            // SourceFile, SourceDebugExtension, LineNumberTable, LocalVariableTable and LocalVariableTypeTable
+            SKIP_DEBUG = 1 << 0,
+            SKIP_CODE = 1 << 1,
+            // Runtime(In)Visible(Parameter)Annotations
+            SKIP_ANNOTATIONS = 1 << 2,
+            // Skipped attributes are kept as RawAttribute and written back unchanged. Without it they are
+            // dropped, along with their share of the enclosing counts and lengths.
+            KEEP_RAW = 1 << 3,
+            // See Parser::setLazyCode
+            LAZY_CODE = 1 << 4,
+            // See Parser::setValidateUTF8
+            VALIDATE_UTF8 = 1 << 5,
+            // Fields, methods and attributes remember their bytes in the input, and are written back by copying
+            // them for as long as they still describe the node (see SourceBacked). Only inputs resident in memory
+            // are recorded.
+            COPY_UNCHANGED = 1 << 6
+        };
+
+        [[nodiscard]] static bool skips(std::uint32_t options, AttributeInfo::AttributeNameTag tag) {
+            switch (tag) {
+                case AttributeInfo::SOURCE_FILE:
+                case AttributeInfo::SOURCE_DEBUG_EXTENSION:
+                case AttributeInfo::LINE_NUMBER_TABLE:
+                case AttributeInfo::LOCAL_VARIABLE_TABLE:
+                case AttributeInfo::LOCAL_VARIABLE_TYPE_TABLE:
+                    return options & SKIP_DEBUG;
+                case AttributeInfo::CODE:
+                    return options & SKIP_CODE;
+                case AttributeInfo::RUNTIME_VISIBLE_ANNOTATIONS:
+                case AttributeInfo::RUNTIME_INVISIBLE_ANNOTATIONS:
+                case AttributeInfo::RUNTIME_VISIBLE_PARAMETER_ANNOTATIONS:
+                case AttributeInfo::RUNTIME_INVISIBLE_PARAMETER_ANNOTATIONS:
+                    return options & SKIP_ANNOTATIONS;
+                default:
+                    return false;
+            }
+        }
+
+        // Skipped and not kept: stepped over by attribute_length and left out of the result
+        [[nodiscard]] static bool drops(std::uint32_t options, AttributeInfo::AttributeNameTag tag) {
+            return !(options & KEEP_RAW) && skips(options, tag);
+        }
+    };
+
     class ParserContext {
     public:
-        ParserContext() : byteOffset(0), codeStartOffset(0) {}
+        ParserContext() : constantPool(std::make_shared<ConstantPool>()), byteOffset(0), codeStartOffset(0) {}
+
+        // Shares an already parsed constant pool, for decoding lazily parsed attributes
+        explicit ParserContext(std::shared_ptr<const ConstantPool> constantPool)
+            : constantPool(std::const_pointer_cast<ConstantPool>(std::move(constantPool))), byteOffset(0), codeStartOffset(0) {}
 
-        void incrementByteOffset() { byteOffset += 1; }
+        // Readies the context for the next class. The constant pool's storage is reused unless a parse result still
+        // holds the pool, in which case a new one is allocated and true is returned.
+        bool reset() {
+            byteOffset = 0;
+            codeStartOffset = 0;
+            attributeNameTags.clear();
+            if (constantPool.use_count() == 1) {
+                constantPool->clear();
+                return false;
+            }
+            constantPool = std::make_shared<ConstantPool>();
+            return true;
+        }
+
+        void incrementByteOffset(long long count = 1) { byteOffset += count; }
         [[nodiscard]] long long getByteOffset() const { return byteOffset; }
 
         void setCodeStartOffset(long long offset) { codeStartOffset = offset; }
         [[nodiscard]] long long getCodeStartOffset() const { return codeStartOffset; }
 
-        void addConstantToPool(const CPInfo& constant) { constantPool.push_back(constant); }
-        [[nodiscard]] std::string getConstantUTF8(int idx) const;
+        [[nodiscard]] const std::shared_ptr<ConstantPool> &getConstantPool() const { return constantPool; }
 
-        [[nodiscard]] CPInfo getConstant(int idx) const;
+        // The view points into the constant pool and lives as long as it does
+        [[nodiscard]] std::string_view getConstantUTF8(int idx) const { return constantPool->utf8(idx); }
+
+        // The kind of attribute named by the Utf8 entry at idx. Each entry is hashed the first time it is used
+        // as an attribute name; afterwards the lookup is one array load.
+        AttributeInfo::AttributeNameTag getAttributeNameTag(std::uint16_t idx) {
+            if (idx >= attributeNameTags.size()) {
+                attributeNameTags.resize(constantPool->getCount(), UNRESOLVED_NAME_TAG);
+            }
+            auto &tag = attributeNameTags[idx];
+            if (tag == UNRESOLVED_NAME_TAG) {
+                tag = AttributeInfo::getAttributeNameTag(constantPool->utf8(idx));
+            }
+            return static_cast<AttributeInfo::AttributeNameTag>(tag);
+        }
     private:
-        std::vector<CPInfo> constantPool;
+        static constexpr std::uint8_t UNRESOLVED_NAME_TAG = 0xFF;
+
+        std::shared_ptr<ConstantPool> constantPool;
         long long byteOffset;
         long long codeStartOffset;
+        // Indexed by constant pool index, UNRESOLVED_NAME_TAG until first looked up
+        std::vector<std::uint8_t> attributeNameTags;
     };
 
+    // A Parser and its Reader must only be used from one thread at a time; separate Parsers can run concurrently.
     class Parser {
     public:
-        explicit Parser(Reader *reader) : reader(reader), context(new ParserContext()) {}
+        explicit Parser(Reader *reader) : reader(reader), ownsReader(false), context(new ParserContext()) {}
+
+        // Parses class bytes already in memory without copying them. Attributes without a model point into
+        // bytes, so owner should keep them alive unless they outlive every ClassFile parsed from them.
+        explicit Parser(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner = nullptr)
+            : reader(new Reader(bytes, std::move(owner))), ownsReader(true), context(new ParserContext()) {}
+
+        // Memory the parser allocated for its own state rather than for the results it returns
+        struct Allocations {
+            // Constant pools allocated because the previous one was still held by a result
+            std::size_t constantPools = 0;
+            // Parses that had to grow the constant pool's storage
+            std::size_t constantPoolGrowths = 0;
+        };
 
         ~Parser() {
+            if (ownsReader) {
+                delete reader;
+            }
             delete context;
         }
 
+        // Prepares to parse another class from bytes, keeping the constant pool storage and other scratch buffers
+        // when no earlier result still refers to them. Options and the thread pool are kept as they are.
+        void reset(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner = nullptr);
+        // As above, reading from reader, which the caller keeps ownership of
+        void reset(Reader *newReader);
+
+        [[nodiscard]] const Allocations &getAllocations() const { return allocations; }
+
+        // A mask of ParseOptions bits. Skipped attributes are stepped over without being decoded, by both the
+        // tree and visitor parsers.
+        void setOptions(std::uint32_t parseOptions) { options = parseOptions; }
+        [[nodiscard]] std::uint32_t getOptions() const { return options; }
+
+        // In lazy mode Code attributes keep a view of their raw bytes in the input, kept alive by the reader's
+        // owner, and are only decoded when CodeAttribute::getCode() and friends are first called. Only the
+        // stream backend, whose reads do not outlive the next one, copies the bytes. Nested attributes are decoded
+        // with KEEP_RAW, since the body's length is fixed by then: SKIP_DEBUG does not drop a Code attribute's
+        // LineNumberTable and other debug attributes in lazy mode. Off by default.
+        void setLazyCode(bool lazy) { setOption(ParseOptions::LAZY_CODE, lazy); }
+        [[nodiscard]] bool isLazyCode() const { return options & ParseOptions::LAZY_CODE; }
+
+        // Checks every CONSTANT_Utf8 entry with mutf8::validate and fails with BAD_UTF8 on malformed ones.
+        // Off by default.
+        void setValidateUTF8(bool validate) { setOption(ParseOptions::VALIDATE_UTF8, validate); }
+        [[nodiscard]] bool isValidateUTF8() const { return options & ParseOptions::VALIDATE_UTF8; }
+
+        // Decodes the methods of classes whose methods take at least minimumBytes on pool, alongside the calling
+        // thread, which also takes part so a parse running on one of pool's workers cannot deadlock it. Only
+        // inputs resident in memory are split; the stream backend is always parsed sequentially.
+        void setThreadPool(ThreadPool *pool, std::size_t minimumBytes = 64 * 1024) {
+            threadPool = pool;
+            parallelMethodsBytes = minimumBytes;
+        }
+
+        // The parse* entry points report malformed input as a ParseError and never throw or print. The consume*
+        // entry points below throw the error instead (see makeParseException).
+        std::expected<ClassFile, ParseError> parseClassFile();
+        // Reports the class to visitor as it is read, without building a ClassFile. On error the visit stops
+        // early and visitEnd() is not called.
+        std::expected<void, ParseError> parseClassFile(ClassVisitor& visitor);
+        // Reads the constant pool and member declarations, stepping over every attribute without decoding it
+        std::expected<ClassHeader, ParseError> parseClassHeader();
+
         ClassFile consumeClassFile();
+        void consumeClassFile(ClassVisitor& visitor);
+        ClassHeader consumeClassHeader();
 
         void consumeMagic();
-        CPInfo consumeConstantPoolInfo();
+        void consumeConstantPoolInfo(ConstantPool& constantPool, std::uint16_t constantPoolCount);
         ClassFile::FieldInfo consumeFieldInfo();
         ClassFile::MethodInfo consumeMethodInfo();
         AttributeInfo *consumeAttributesInfo();
 
         Instruction consumeInstruction();
+        // Decodes the next instruction straight into stream, without building an Instruction
+        void consumeInstruction(InstructionStream& stream);
 
         [[nodiscard]] ParserContext *getContext() const { return context; }
 
+        // The first error met so far. Once set, every further read returns zeros and loops stop early.
+        [[nodiscard]] const std::optional<ParseError> &getError() const { return error; }
+
     private:
+        Parser(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner, ParserContext *context)
+            : reader(new Reader(bytes, std::move(owner))), ownsReader(true), context(context) {}
+
+        // Reads constant_pool_count and the entries into the context's constant pool
+        void consumeConstantPool();
+
+        void setOption(std::uint32_t option, bool enabled) { options = enabled ? options | option : options & ~option; }
+
+        // Fills methods from a skip-scan of the methods section followed by concurrent decoding of each method,
+        // when a thread pool is set and the input is resident. False if nothing was read.
+        bool consumeMethodsInParallel(std::uint16_t methodsCount, std::vector<ClassFile::MethodInfo> &methods);
+
+        // Reads the code array, exception table and nested attributes that follow code_length. Returns the bytes
+        // of nested attributes that were dropped.
+        std::uint32_t consumeCode(CodeAttribute *codeAttribute);
+
+        // Reads attribute_name_index and attribute_length
+        struct AttributeHeader {
+            std::string_view name;
+            std::uint32_t length;
+            AttributeInfo::AttributeNameTag tag;
+        };
+        AttributeHeader consumeAttributeHeader();
+        // With COPY_UNCHANGED, gives node the input bytes from start up to the current offset
+        void recordSource(SourceBacked &node, std::size_t start);
+        void visitCode(MethodVisitor &visitor, std::uint32_t attributeLength);
+
+        void fail(ParseError::Reason reason);
+        // False once parsing has failed, or if the input ends before count more bytes
+        bool canConsume(std::size_t count);
+        // Name and descriptor lookup that fails instead of throwing on a bad index
+        std::string_view consumeUTF8Index();
+        std::string_view getConstantUTF8(std::uint16_t index);
+        std::uint32_t consumeCodeLength();
+
         std::uint8_t consumeOneByte();
         std::uint16_t consumeTwoBytes();
         std::uint32_t consumeFourBytes();
+        std::span<const std::uint8_t> consumeBytes(std::size_t count);
+        void skipBytes(std::size_t count);
 
         Reader *reader;
+        bool ownsReader;
         ParserContext *context;
+        std::uint32_t options = 0;
+        ThreadPool *threadPool = nullptr;
+        std::size_t parallelMethodsBytes = 0;
+        std::optional<ParseError> error;
+        Allocations allocations;
     };
 }
 
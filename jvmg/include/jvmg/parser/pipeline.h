@@ -0,0 +1,83 @@
+//
+// Created by Micky on 2/7/2024.
+//
+
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include "jvmg/parser/parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jvmg {
+    struct PipelineOptions {
+        unsigned readThreads = 1;
+        unsigned inflateThreads = 2;
+        unsigned parseThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        unsigned consumeThreads = 1;
+
+        // Maximum number of items waiting between two stages
+        std::size_t queueCapacity = 1024;
+
+        // Upper bound on uncompressed class bytes that have been read but not yet consumed.
+        // The read stage stalls once it is reached; a single class larger than the budget is let through alone.
+        std::size_t memoryBudget = 256 * 1024 * 1024;
+
+        // ParseOptions bits applied to every class
+        std::uint32_t parseOptions = 0;
+    };
+
+    struct StageStats {
+        std::uint64_t items = 0;
+        std::uint64_t bytes = 0;
+        // Summed over the stage's threads
+        std::chrono::nanoseconds busyTime{0};
+        // Time spent waiting on a full downstream queue or on the memory budget
+        std::chrono::nanoseconds blockedTime{0};
+    };
+
+    struct PipelineStats {
+        StageStats read;
+        StageStats inflate;
+        StageStats parse;
+        StageStats consume;
+        std::chrono::nanoseconds wallTime{0};
+        std::size_t peakBytesInFlight = 0;
+
+        [[nodiscard]] double itemsPerSecond(const StageStats& stage) const {
+            return wallTime.count() == 0 ? 0.0 : stage.items * 1e9 / static_cast<double>(wallTime.count());
+        }
+
+        [[nodiscard]] double bytesPerSecond(const StageStats& stage) const {
+            return wallTime.count() == 0 ? 0.0 : stage.bytes * 1e9 / static_cast<double>(wallTime.count());
+        }
+    };
+
+    // Streams class files from jars and loose .class files through
+    // read -> inflate -> parse -> consume, with bounded queues between stages and a byte budget on the
+    // data in flight, so memory use does not grow with the size of the input.
+    class Pipeline {
+    public:
+        // Called from the consume stage's threads. name is the jar entry name or the .class path.
+        using Consumer = std::function<void(const std::string& name, ClassFile&& classFile)>;
+
+        explicit Pipeline(PipelineOptions options = PipelineOptions()) : options(options) {}
+
+        // Inputs ending in .jar are read as archives, anything else as a single class file.
+        // Every input is processed; the first error is rethrown at the end.
+        PipelineStats run(const std::vector<std::string>& inputs, const Consumer& consumer);
+
+    private:
+        PipelineOptions options;
+    };
+}
+
+#endif //_PIPELINE_H
@@ -7,28 +7,132 @@
 
 #include "jvmg/IR/classfile.h"
 
+#include <bit>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <iostream>
 #include <filesystem>
 #include <bitset>
+#include <span>
+#include <stdexcept>
+#include <vector>
 
 namespace jvmg {
+    // Reads big-endian class file data from one of several backends:
+    //  - MAPPED: the file is memory-mapped and read in place
+    //  - BUFFER: a caller-owned byte span is read in place (no copy, no filesystem access)
+    //  - STREAM: the file is read through a std::ifstream in large chunks (fallback when mapping is unavailable)
+    // All backends serve reads from a contiguous window [cursor, end), so the common case is a bounds check
+    // plus an unaligned load.
     class Reader {
     public:
-        explicit Reader(const std::string& filename) : filename(filename) {
-            srcFile = std::ifstream(filename, std::ios_base::binary);
-        }
+        enum Backend {
+            MAPPED,
+            BUFFER,
+            STREAM
+        };
+
+        // Maps the file if the platform supports it, and falls back to the stream backend otherwise
+        explicit Reader(const std::string& filename);
+        Reader(const std::string& filename, Backend backend);
+
+        // Reads directly from bytes. Unless owner keeps them alive, they must outlive the Reader and everything
+        // parsed from it.
+        explicit Reader(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner = nullptr);
+
+        // Starts over on bytes with the buffer backend, keeping the stream backend's buffer for reuse
+        void reset(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner = nullptr);
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        ~Reader() = default;
 
         std::uint8_t readByte() {
-            std::uint8_t byte;
-            srcFile.read((char *)&byte, 1);
-            return byte;
+            if (end == cursor) {
+                underflow(1);
+            }
+            return *cursor++;
+        }
+
+        std::uint16_t readTwoBytes() { return readBigEndian<std::uint16_t>(); }
+        std::uint32_t readFourBytes() { return readBigEndian<std::uint32_t>(); }
+        std::uint64_t readEightBytes() { return readBigEndian<std::uint64_t>(); }
+
+        // Returns a view of the next count bytes. For the mapped and buffer backends this points into the input;
+        // for the stream backend it is only valid until the next read.
+        std::span<const std::uint8_t> readBytes(std::size_t count) {
+            if (static_cast<std::size_t>(end - cursor) < count) {
+                underflow(count);
+            }
+            std::span<const std::uint8_t> bytes(cursor, count);
+            cursor += count;
+            return bytes;
+        }
+
+        void skipBytes(std::size_t count) { readBytes(count); }
+
+        // Makes count bytes available to the next reads without throwing; false if the input ends first
+        bool ensure(std::size_t count) {
+            return static_cast<std::size_t>(end - cursor) >= count || refill(count);
+        }
+
+        // Moves back to offset, at or before the current one. Only for the mapped and buffer backends, whose
+        // whole input stays in the window.
+        void rewind(std::size_t offset) { cursor = window + (offset - windowOffset); }
+
+        // Number of bytes consumed since the start of the input
+        [[nodiscard]] std::size_t getOffset() const { return windowOffset + (cursor - window); }
+
+        [[nodiscard]] Backend getBackend() const { return backend; }
+
+        // Keeps the bytes returned by readBytes alive after the Reader is gone: the mapping for the mapped
+        // backend, the owner passed in for the buffer backend. Null for the stream backend, whose reads are
+        // only valid until the next one.
+        [[nodiscard]] const std::shared_ptr<const void> &getOwner() const { return owner; }
+
+        // The whole input when it is resident in memory, empty for the stream backend
+        [[nodiscard]] std::span<const std::uint8_t> getBuffer() const {
+            return backend == STREAM ? std::span<const std::uint8_t>() : std::span<const std::uint8_t>(window, end);
         }
 
     private:
-        const std::string filename;
+        template<typename T>
+        T readBigEndian() {
+            if (static_cast<std::size_t>(end - cursor) < sizeof(T)) {
+                underflow(sizeof(T));
+            }
+            T value;
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            if constexpr (std::endian::native == std::endian::little) {
+                value = std::byteswap(value);
+            }
+            return value;
+        }
+
+        // Makes at least count bytes available at cursor, or throws if the input is exhausted
+        void underflow(std::size_t count);
+        // As underflow, but returns false instead of throwing
+        bool refill(std::size_t count);
+
+        bool openMapped();
+        void openStream();
+
+        std::string filename;
+        Backend backend;
+
+        const std::uint8_t *window = nullptr;
+        const std::uint8_t *cursor = nullptr;
+        const std::uint8_t *end = nullptr;
+        std::size_t windowOffset = 0;
+
+        std::shared_ptr<const void> owner;
+
         std::ifstream srcFile;
+        std::vector<std::uint8_t> streamBuffer;
     };
 }
 
@@ -0,0 +1,124 @@
+//
+// Created by Micky on 2/7/2024.
+//
+
+#ifndef _BOUNDED_QUEUE_H
+#define _BOUNDED_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace jvmg {
+    // Fixed-capacity multi-producer/multi-consumer queue (Vyukov's bounded MPMC design).
+    // tryPush/tryPop are lock-free; push/pop back off and retry, which is how a full queue
+    // pushes back on the stage feeding it.
+    template<typename T>
+    class BoundedQueue {
+    public:
+        // Capacity is rounded up to a power of two
+        explicit BoundedQueue(std::size_t capacity)
+            : mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1), cells(new Cell[mask + 1]) {
+            for (std::size_t i = 0; i <= mask; i++) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        bool tryPush(T& value) {
+            std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = cells[pos & mask];
+                std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool tryPop(T& value) {
+            std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = cells[pos & mask];
+                std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        value = std::move(cell.value);
+                        cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Blocks while the queue is full. Returns the time spent waiting.
+        std::chrono::nanoseconds push(T value) {
+            if (tryPush(value)) {
+                return std::chrono::nanoseconds(0);
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned attempt = 0; !tryPush(value); attempt++) {
+                backoff(attempt);
+            }
+            return std::chrono::steady_clock::now() - start;
+        }
+
+        // Blocks while the queue is empty. Returns false once the queue is closed and drained.
+        bool pop(T& value) {
+            for (unsigned attempt = 0; !tryPop(value); attempt++) {
+                if (closed.load(std::memory_order_acquire)) {
+                    // Items pushed before close() are still visible to one last attempt
+                    return tryPop(value);
+                }
+                backoff(attempt);
+            }
+            return true;
+        }
+
+        // Called once every producer is done
+        void close() { closed.store(true, std::memory_order_release); }
+
+    private:
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        static void backoff(unsigned attempt) {
+            if (attempt < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+
+        const std::size_t mask;
+        std::unique_ptr<Cell[]> cells;
+
+        alignas(64) std::atomic<std::size_t> enqueuePos = 0;
+        alignas(64) std::atomic<std::size_t> dequeuePos = 0;
+        alignas(64) std::atomic<bool> closed = false;
+    };
+}
+
+#endif //_BOUNDED_QUEUE_H
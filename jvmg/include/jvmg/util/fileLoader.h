@@ -0,0 +1,64 @@
+//
+// Created by Micky on 2/6/2024.
+//
+
+#ifndef _FILE_LOADER_H
+#define _FILE_LOADER_H
+
+#include "jvmg/util/threadPool.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace jvmg {
+    // Reads many whole files into memory. On Linux the open/statx/read/close calls for a batch of files
+    // are issued together through io_uring, so a batch costs a handful of syscalls instead of several per file.
+    // Where io_uring is unavailable the files are read with plain blocking I/O on a thread pool.
+    class FileLoader {
+    public:
+        enum Backend {
+            IO_URING,
+            THREADED
+        };
+
+        // Receives ownership of each file's contents as soon as it has been read. The io_uring backend calls it
+        // on the thread running load(); the threaded backend calls it concurrently from its workers.
+        using Callback = std::function<void(std::size_t index, std::vector<std::uint8_t>&& bytes)>;
+
+        explicit FileLoader(unsigned batchSize = 64, unsigned threadCount = std::thread::hardware_concurrency());
+        FileLoader(Backend backend, unsigned batchSize = 64, unsigned threadCount = std::thread::hardware_concurrency());
+
+        FileLoader(const FileLoader&) = delete;
+        FileLoader& operator=(const FileLoader&) = delete;
+
+        ~FileLoader();
+
+        // Loads every file, then rethrows the first error: a std::system_error carrying the errno of a file that
+        // could not be read, or a callback exception
+        void load(const std::vector<std::string>& filenames, const Callback& callback);
+
+        [[nodiscard]] Backend getBackend() const { return backend; }
+
+        // True if this kernel has io_uring with every operation the IO_URING backend uses
+        static bool isIoUringAvailable();
+
+    private:
+        struct Ring;
+
+        void loadBatch(const std::vector<std::string>& filenames, std::size_t begin, std::size_t end,
+                       const Callback& callback, std::exception_ptr& firstError);
+        void loadThreaded(const std::vector<std::string>& filenames, const Callback& callback);
+
+        Backend backend;
+        unsigned batchSize;
+        unsigned threadCount;
+        Ring *ring = nullptr;
+        // Created by the first threaded load and kept for the next ones
+        std::unique_ptr<ThreadPool> pool;
+    };
+}
+
+#endif //_FILE_LOADER_H
@@ -0,0 +1,55 @@
+//
+// Created by Micky on 2/18/2024.
+//
+
+#ifndef _FILE_WRITER_H
+#define _FILE_WRITER_H
+
+#include "jvmg/util/util.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jvmg {
+    // Writes serialized classes to disk with one write call per file. A batch is serialized and written on a
+    // thread pool, each class going into a reused page-aligned buffer rather than a buffer of its own.
+    class FileWriter {
+    public:
+        // One class of a batch
+        struct Output {
+            // Path relative to the output directory, such as "pkg/Switch.class"
+            std::string name;
+            Serializable *node;
+        };
+
+        explicit FileWriter(unsigned threadCount = std::thread::hardware_concurrency()) : threadCount(threadCount) {}
+
+        // Reserves each file's blocks with posix_fallocate before writing it, which keeps large files contiguous.
+        // Off by default; ignored where unsupported.
+        void setPreallocate(bool enabled) { preallocate = enabled; }
+        [[nodiscard]] bool isPreallocate() const { return preallocate; }
+
+        // Opens files with O_DIRECT so the written classes do not fill the page cache. Off by default; files on
+        // filesystems that refuse it are written normally.
+        void setDirect(bool enabled) { direct = enabled; }
+        [[nodiscard]] bool isDirect() const { return direct; }
+
+        // Writes every output under directory, creating the directories it needs, then rethrows the first error
+        void write(const std::filesystem::path &directory, const std::vector<Output> &outputs);
+
+        // Replaces filename with bytes in a single write, retried only for what a short write left over.
+        // Throws std::system_error on failure.
+        static void writeFile(const std::string &filename, std::span<const std::uint8_t> bytes);
+
+    private:
+        unsigned threadCount;
+        bool preallocate = false;
+        bool direct = false;
+    };
+}
+
+#endif //_FILE_WRITER_H
@@ -0,0 +1,40 @@
+//
+// Created by Micky on 2/15/2024.
+//
+
+#ifndef _MUTF8_H
+#define _MUTF8_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace jvmg::mutf8 {
+    // Modified UTF-8, as used by CONSTANT_Utf8 entries, encodes a string one UTF-16 code unit at a time in
+    // 1-3 bytes. NUL is written as C0 80 so no zero byte appears, and supplementary characters are written as
+    // two 3-byte surrogates instead of one 4-byte sequence.
+    //
+    // Runs of ASCII are scanned 16 or 32 bytes at a time (SSE2, or AVX2 when the CPU has it); everything else
+    // goes through a scalar decoder.
+
+    // True if bytes is well-formed modified UTF-8. Unpaired surrogates are accepted, as the JVM accepts them.
+    bool validate(std::string_view bytes);
+
+    // Length of the prefix of bytes made of ASCII other than NUL, which is encoded identically in UTF-8 and
+    // modified UTF-8
+    std::size_t asciiPrefixLength(std::string_view bytes);
+
+    // Converts to standard UTF-8. Surrogate pairs become one 4-byte sequence and unpaired surrogates become
+    // U+FFFD. Empty if bytes is not valid modified UTF-8.
+    std::optional<std::string> toUTF8(std::string_view bytes);
+    // Empty if bytes is not valid modified UTF-8
+    std::optional<std::u16string> toUTF16(std::string_view bytes);
+
+    // Empty if utf8 is not valid UTF-8
+    std::optional<std::string> fromUTF8(std::string_view utf8);
+    std::string fromUTF16(std::u16string_view utf16);
+}
+
+#endif //_MUTF8_H
@@ -0,0 +1,65 @@
+//
+// Created by Micky on 2/5/2024.
+//
+
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jvmg {
+    // Fixed-size pool where every worker owns a task deque. Workers take from the front of their own deque
+    // and steal from the back of the others' once it runs dry, so uneven task sizes even out across threads.
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency());
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool();
+
+        // Tasks submitted from a worker go to that worker's deque, others are spread round-robin
+        void submit(Task task);
+
+        // Blocks until every submitted task has finished, then rethrows the first exception a task threw
+        void wait();
+
+        [[nodiscard]] unsigned getThreadCount() const { return static_cast<unsigned>(queues.size()); }
+
+    private:
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        void workerLoop(unsigned index);
+        bool takeTask(unsigned index, Task& task);
+
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex stateMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        std::size_t queuedCount = 0;
+        std::size_t pendingCount = 0;
+        bool stopping = false;
+        std::exception_ptr firstError;
+
+        std::atomic<unsigned> nextQueue = 0;
+    };
+}
+
+#endif //_THREAD_POOL_H
@@ -6,34 +6,135 @@
 #define _UTIL_H
 
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace jvmg {
+    // A node that writes itself in class file format. serialize() walks the tree twice: a sizing pass that only
+    // counts bytes, then a writing pass into a buffer allocated once at that size. Nodes write their children
+    // with serializeChild(), so every byte goes straight to its place in the root's buffer.
+    //
+    // Lengths and counts are derived while writing, from what is actually written, and stored back into the
+    // nodes' fields; the values the fields held before are ignored.
     class Serializable {
     public:
         std::vector<std::uint8_t> &serialize();
 
+        // The two passes of serialize() on their own, for writing into a buffer the caller owns: out must hold
+        // exactly getSerializedSize() bytes
+        std::size_t getSerializedSize();
+        void serializeInto(std::span<std::uint8_t> out);
+
         void clearBuffer() { _buffer.clear(); }
 
         std::vector<uint8_t> &getBytes() { return _buffer; }
 
-        void insertBytes(std::vector<std::uint8_t> &bytes);
+        void insertBytes(std::span<const std::uint8_t> bytes) { write(bytes.data(), bytes.size()); }
+
+        // Writes child into the output this node is writing to
+        void serializeChild(Serializable &child);
+
+        // Writes child after a u4 holding its length in bytes, which is filled in once child has been written,
+        // and returns that length
+        std::uint32_t serializeChildWithLength(Serializable &child);
 
-        void serializeBytes(std::uint8_t bytes);
+        // Sets count to actual and writes it as a u2. Throws std::length_error if actual does not fit.
+        void serializeCount(std::uint16_t &count, std::size_t actual);
+
+        void serializeBytes(std::uint8_t bytes) { write(&bytes, 1); }
 
         // Example - takes in 0xCAFE and serializes [CA, FE]
-        void serializeBytes(std::uint16_t bytes);
+        void serializeBytes(std::uint16_t bytes) {
+            std::uint8_t encoded[2] = {static_cast<std::uint8_t>(bytes >> 8), static_cast<std::uint8_t>(bytes)};
+            write(encoded, sizeof(encoded));
+        }
 
         // Example - takes in 0xCAFEBABE and serializes [CA, FE, BA, BE]
-        void serializeBytes(std::uint32_t bytes);
+        void serializeBytes(std::uint32_t bytes) {
+            std::uint8_t encoded[4] = {static_cast<std::uint8_t>(bytes >> 24), static_cast<std::uint8_t>(bytes >> 16),
+                                       static_cast<std::uint8_t>(bytes >> 8), static_cast<std::uint8_t>(bytes)};
+            write(encoded, sizeof(encoded));
+        }
 
+        // Serializes afresh and writes the class with FileWriter::writeFile
         void outputToFile(std::string_view filename);
 
+    protected:
+        // Bytes to write instead of calling _serialize(), for a node that can be copied through unchanged
+        [[nodiscard]] virtual std::span<const std::uint8_t> getUnchangedBytes() const { return {}; }
+
     private:
+        // The output of one serialize() call, shared by every node it reaches. A null cursor means the
+        // sizing pass.
+        struct Output {
+            std::uint8_t *cursor = nullptr;
+            std::size_t size = 0;
+        };
+
         virtual void _serialize() = 0;
+        // _serialize(), or a copy of getUnchangedBytes() when there are any
+        void serializeSelf();
+
+        void write(const std::uint8_t *bytes, std::size_t count) {
+            // An empty span may have a null data pointer, which memcpy must not be given even for 0 bytes
+            if (count == 0) {
+                return;
+            }
+            if (output->cursor != nullptr) {
+                std::memcpy(output->cursor, bytes, count);
+                output->cursor += count;
+            }
+            output->size += count;
+        }
 
         std::vector<std::uint8_t> _buffer;
+        Output *output = nullptr;
+    };
+
+    class ConstantPool;
+
+    // A node read from a class file that keeps its bytes there, and is written back by copying them for as long
+    // as they still describe it. Those bytes hold constant pool indices, so a node stops copying once the pool it
+    // was read against is cleared or loses entries. Nodes compare the fields they expose against the bytes, and
+    // attributes keep the rest of their contents behind accessors that notice them being handed out for changing
+    // (see Attribute::matchesInfo). markDirty() forces a node to be written from the tree.
+    class SourceBacked : public Serializable {
+    public:
+        // owner keeps bytes alive, as for RawAttribute. constantPool is the pool bytes index into.
+        void setSource(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner,
+                       const std::shared_ptr<const ConstantPool> &constantPool);
+        [[nodiscard]] std::span<const std::uint8_t> getSource() const { return source; }
+
+        void markDirty() { dirty = true; }
+        [[nodiscard]] bool isDirty() const { return dirty; }
+
+        // True if the source bytes can be written back as they are. Once false it stays false, as a change undone
+        // by hand is not worth telling apart.
+        [[nodiscard]] bool isUnchanged() const;
+
+    protected:
+        // Overridden by nodes with fields or children that can change without the node being marked dirty
+        [[nodiscard]] virtual bool contentsUnchanged() const { return true; }
+        // The big-endian u2 at offset in the source, for comparing a field with what was read
+        [[nodiscard]] std::uint16_t sourceU2(std::size_t offset) const {
+            return static_cast<std::uint16_t>((source[offset] << 8) | source[offset + 1]);
+        }
+
+    private:
+        [[nodiscard]] std::span<const std::uint8_t> getUnchangedBytes() const override {
+            return isUnchanged() ? source : std::span<const std::uint8_t>();
+        }
+
+        std::span<const std::uint8_t> source;
+        std::shared_ptr<const void> sourceOwner;
+        std::weak_ptr<const ConstantPool> sourcePool;
+        // The pool's generation and count when the source was set; it may only have grown since
+        std::uint64_t sourcePoolGeneration = 0;
+        std::uint16_t sourcePoolCount = 0;
+        mutable bool dirty = false;
     };
 }
 
@@ -0,0 +1,268 @@
+//
+// Created by Micky on 2/9/2024.
+//
+
+#include "jvmg/IR/ConstantPool/constantPool.h"
+
+#include <atomic>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+using namespace jvmg;
+
+namespace {
+    // Shared by every pool, so that no two clears hand out the same generation
+    std::atomic<std::uint64_t> nextGeneration{1};
+
+    void append16(std::uint8_t *out, std::uint16_t value) {
+        out[0] = (value & 0xFF00) >> 8;
+        out[1] = value & 0xFF;
+    }
+
+    void append32(std::uint8_t *out, std::uint32_t value) {
+        append16(out, value >> 16);
+        append16(out + 2, value & 0xFFFF);
+    }
+}
+
+std::size_t ConstantPool::getPayloadSize(ConstantType tag) {
+    switch (tag) {
+        case CONSTANT_Class:
+        case CONSTANT_String:
+        case CONSTANT_MethodType:
+        case CONSTANT_Module:
+        case CONSTANT_Package:
+            return 2;
+        case CONSTANT_MethodHandle:
+            return 3;
+        case CONSTANT_Fieldref:
+        case CONSTANT_Methodref:
+        case CONSTANT_InterfaceMethodref:
+        case CONSTANT_NameAndType:
+        case CONSTANT_Integer:
+        case CONSTANT_Float:
+        case CONSTANT_Dynamic:
+        case CONSTANT_InvokeDynamic:
+            return 4;
+        case CONSTANT_Long:
+        case CONSTANT_Double:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+void ConstantPool::reserve(std::size_t entries, std::size_t payloadBytes) {
+    tags.reserve(entries);
+    offsets.reserve(entries + 1);
+    data.reserve(payloadBytes);
+}
+
+void ConstantPool::clear() {
+    // Slot 0 is always UNUSABLE with an empty payload
+    tags.resize(1);
+    offsets.resize(2);
+    data.clear();
+    generation = nextGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint16_t ConstantPool::add(ConstantType tag, std::span<const std::uint8_t> payload) {
+    checkRoomFor(tag);
+    auto index = getCount();
+    tags.push_back(tag);
+    data.insert(data.end(), payload.begin(), payload.end());
+    offsets.push_back(static_cast<std::uint32_t>(data.size()));
+
+    if (isWide(tag)) {
+        tags.push_back(UNUSABLE);
+        offsets.push_back(static_cast<std::uint32_t>(data.size()));
+    }
+
+    return index;
+}
+
+void ConstantPool::checkRoomFor(ConstantType tag) const {
+    // constant_pool_count is a u2, so the last entry must end below index 65535
+    if (tags.size() + (isWide(tag) ? 2 : 1) > UINT16_MAX) {
+        throw std::length_error("Constant pool has no index left for another entry");
+    }
+}
+
+std::uint16_t ConstantPool::addClass(std::uint16_t nameIndex) {
+    std::uint8_t payload[2];
+    append16(payload, nameIndex);
+    return add(CONSTANT_Class, payload);
+}
+
+std::uint16_t ConstantPool::addFieldRef(std::uint16_t classIndex, std::uint16_t nameAndTypeIndex) {
+    std::uint8_t payload[4];
+    append16(payload, classIndex);
+    append16(payload + 2, nameAndTypeIndex);
+    return add(CONSTANT_Fieldref, payload);
+}
+
+std::uint16_t ConstantPool::addMethodRef(std::uint16_t classIndex, std::uint16_t nameAndTypeIndex) {
+    std::uint8_t payload[4];
+    append16(payload, classIndex);
+    append16(payload + 2, nameAndTypeIndex);
+    return add(CONSTANT_Methodref, payload);
+}
+
+std::uint16_t ConstantPool::addInterfaceMethodRef(std::uint16_t classIndex, std::uint16_t nameAndTypeIndex) {
+    std::uint8_t payload[4];
+    append16(payload, classIndex);
+    append16(payload + 2, nameAndTypeIndex);
+    return add(CONSTANT_InterfaceMethodref, payload);
+}
+
+std::uint16_t ConstantPool::addString(std::uint16_t stringIndex) {
+    std::uint8_t payload[2];
+    append16(payload, stringIndex);
+    return add(CONSTANT_String, payload);
+}
+
+std::uint16_t ConstantPool::addInteger(std::int32_t value) {
+    std::uint8_t payload[4];
+    append32(payload, static_cast<std::uint32_t>(value));
+    return add(CONSTANT_Integer, payload);
+}
+
+std::uint16_t ConstantPool::addFloat(float value) {
+    std::uint8_t payload[4];
+    append32(payload, std::bit_cast<std::uint32_t>(value));
+    return add(CONSTANT_Float, payload);
+}
+
+std::uint16_t ConstantPool::addLong(std::int64_t value) {
+    std::uint8_t payload[8];
+    append32(payload, static_cast<std::uint64_t>(value) >> 32);
+    append32(payload + 4, static_cast<std::uint64_t>(value) & 0xFFFFFFFF);
+    return add(CONSTANT_Long, payload);
+}
+
+std::uint16_t ConstantPool::addDouble(double value) {
+    auto bits = std::bit_cast<std::uint64_t>(value);
+    std::uint8_t payload[8];
+    append32(payload, bits >> 32);
+    append32(payload + 4, bits & 0xFFFFFFFF);
+    return add(CONSTANT_Double, payload);
+}
+
+std::uint16_t ConstantPool::addNameAndType(std::uint16_t nameIndex, std::uint16_t descriptorIndex) {
+    std::uint8_t payload[4];
+    append16(payload, nameIndex);
+    append16(payload + 2, descriptorIndex);
+    return add(CONSTANT_NameAndType, payload);
+}
+
+std::uint16_t ConstantPool::addUTF8(std::string_view value) {
+    if (value.size() > UINT16_MAX) {
+        throw std::invalid_argument("UTF8 constant longer than 65535 bytes");
+    }
+    checkRoomFor(CONSTANT_Utf8);
+
+    auto index = getCount();
+    tags.push_back(CONSTANT_Utf8);
+    data.push_back((value.size() & 0xFF00) >> 8);
+    data.push_back(value.size() & 0xFF);
+    data.insert(data.end(), value.begin(), value.end());
+    offsets.push_back(static_cast<std::uint32_t>(data.size()));
+    return index;
+}
+
+std::uint16_t ConstantPool::addMethodHandle(std::uint8_t referenceKind, std::uint16_t referenceIndex) {
+    std::uint8_t payload[3];
+    payload[0] = referenceKind;
+    append16(payload + 1, referenceIndex);
+    return add(CONSTANT_MethodHandle, payload);
+}
+
+std::uint16_t ConstantPool::addMethodType(std::uint16_t descriptorIndex) {
+    std::uint8_t payload[2];
+    append16(payload, descriptorIndex);
+    return add(CONSTANT_MethodType, payload);
+}
+
+std::uint16_t ConstantPool::addInvokeDynamic(std::uint16_t bootstrapMethodAttrIndex, std::uint16_t nameAndTypeIndex) {
+    std::uint8_t payload[4];
+    append16(payload, bootstrapMethodAttrIndex);
+    append16(payload + 2, nameAndTypeIndex);
+    return add(CONSTANT_InvokeDynamic, payload);
+}
+
+std::span<const std::uint8_t> ConstantPool::getPayload(std::uint16_t index) const {
+    if (index >= getCount()) {
+        throw std::out_of_range("Constant pool index " + std::to_string(index) + " out of range");
+    }
+    return std::span<const std::uint8_t>(data).subspan(offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+ConstantPool::MemberRef ConstantPool::memberRef(std::uint16_t index) const {
+    auto tag = getTag(index);
+    if (tag != CONSTANT_Fieldref && tag != CONSTANT_Methodref && tag != CONSTANT_InterfaceMethodref) {
+        throw std::invalid_argument("Constant pool entry #" + std::to_string(index) + " is not a member reference");
+    }
+    auto offset = offsets[index];
+    return {read16(offset), read16(offset + 2)};
+}
+
+ConstantPool::NameAndType ConstantPool::nameAndType(std::uint16_t index) const {
+    auto offset = offsetOf(index, CONSTANT_NameAndType);
+    return {read16(offset), read16(offset + 2)};
+}
+
+ConstantPool::MethodHandle ConstantPool::methodHandle(std::uint16_t index) const {
+    auto offset = offsetOf(index, CONSTANT_MethodHandle);
+    return {data[offset], read16(offset + 1)};
+}
+
+ConstantPool::DynamicRef ConstantPool::dynamicRef(std::uint16_t index) const {
+    auto tag = getTag(index);
+    if (tag != CONSTANT_Dynamic && tag != CONSTANT_InvokeDynamic) {
+        throw std::invalid_argument("Constant pool entry #" + std::to_string(index) + " is not a dynamic reference");
+    }
+    auto offset = offsets[index];
+    return {read16(offset), read16(offset + 2)};
+}
+
+std::int32_t ConstantPool::intValue(std::uint16_t index) const {
+    return static_cast<std::int32_t>(read32(offsetOf(index, CONSTANT_Integer)));
+}
+
+float ConstantPool::floatValue(std::uint16_t index) const {
+    return std::bit_cast<float>(read32(offsetOf(index, CONSTANT_Float)));
+}
+
+std::int64_t ConstantPool::longValue(std::uint16_t index) const {
+    auto offset = offsetOf(index, CONSTANT_Long);
+    return static_cast<std::int64_t>((static_cast<std::uint64_t>(read32(offset)) << 32) | read32(offset + 4));
+}
+
+double ConstantPool::doubleValue(std::uint16_t index) const {
+    auto offset = offsetOf(index, CONSTANT_Double);
+    return std::bit_cast<double>((static_cast<std::uint64_t>(read32(offset)) << 32) | read32(offset + 4));
+}
+
+std::string_view ConstantPool::utf8(std::uint16_t index) const {
+    auto offset = offsetOf(index, CONSTANT_Utf8);
+    // Skip the two length bytes
+    return {reinterpret_cast<const char *>(data.data()) + offset + 2, read16(offset)};
+}
+
+std::uint32_t ConstantPool::offsetOf(std::uint16_t index, ConstantType expected) const {
+    if (getTag(index) != expected) {
+        throw std::invalid_argument("Constant pool entry #" + std::to_string(index) + " has tag " +
+                                    std::to_string(getTag(index)) + ", expected " + std::to_string(expected));
+    }
+    return offsets[index];
+}
+
+void ConstantPool::_serialize() {
+    for (std::uint16_t i = 1; i < getCount(); i++) {
+        if (tags[i] != UNUSABLE) {
+            serializeBytes(static_cast<std::uint8_t>(tags[i]));
+            insertBytes(getPayload(i));
+        }
+    }
+}
@@ -0,0 +1,230 @@
+//
+// Created by Micky on 2/20/2024.
+//
+
+#include "jvmg/IR/ConstantPool/constantPoolBuilder.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+using namespace jvmg;
+
+namespace {
+    constexpr std::size_t MINIMUM_SLOTS = 64;
+
+    void append16(std::uint8_t *out, std::uint16_t value) {
+        out[0] = (value & 0xFF00) >> 8;
+        out[1] = value & 0xFF;
+    }
+
+    void append32(std::uint8_t *out, std::uint32_t value) {
+        append16(out, value >> 16);
+        append16(out + 2, value & 0xFFFF);
+    }
+
+    void append64(std::uint8_t *out, std::uint64_t value) {
+        append32(out, value >> 32);
+        append32(out + 4, value & 0xFFFFFFFF);
+    }
+
+    // Enough slots for entries at three quarters full
+    std::size_t slotsFor(std::size_t entries) {
+        return std::max(MINIMUM_SLOTS, std::bit_ceil(entries * 4 / 3 + 1));
+    }
+}
+
+ConstantPoolBuilder::ConstantPoolBuilder(std::shared_ptr<ConstantPool> pool) {
+    reset(std::move(pool));
+}
+
+void ConstantPoolBuilder::reset(std::shared_ptr<ConstantPool> newPool) {
+    pool = std::move(newPool);
+    auto size = slotsFor(pool->getCount());
+    if (slots.size() < size) {
+        slots.resize(size);
+    }
+    std::fill(slots.begin(), slots.end(), 0);
+    used = 0;
+
+    for (std::uint16_t index = 1; index < pool->getCount(); index++) {
+        auto tag = pool->getTag(index);
+        if (tag == ConstantPool::UNUSABLE) {
+            continue;
+        }
+        auto payload = pool->getPayload(index);
+        auto entryHash = hash(tag, payload);
+        if (find(entryHash, tag, payload) == 0) {
+            insert(entryHash, index);
+        }
+    }
+}
+
+std::uint64_t ConstantPoolBuilder::hash(ConstantPool::ConstantType tag, std::span<const std::uint8_t> payload) {
+    std::string_view bytes(reinterpret_cast<const char *>(payload.data()), payload.size());
+    std::uint64_t value = std::hash<std::string_view>{}(bytes) ^ (tag * 0x9E3779B97F4A7C15ULL);
+    // Murmur3's finalizer, so that both the low bits picking the slot and the high bits kept in it are mixed
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+std::uint16_t ConstantPoolBuilder::find(std::uint64_t entryHash, ConstantPool::ConstantType tag,
+                                        std::span<const std::uint8_t> payload) const {
+    auto fragment = static_cast<std::uint32_t>(entryHash >> 48) << 16;
+    auto mask = slots.size() - 1;
+    for (auto position = entryHash & mask; slots[position] != 0; position = (position + 1) & mask) {
+        auto slot = slots[position];
+        if ((slot & 0xFFFF0000) != fragment) {
+            continue;
+        }
+        auto index = static_cast<std::uint16_t>(slot);
+        if (pool->getTag(index) == tag && std::ranges::equal(pool->getPayload(index), payload)) {
+            return index;
+        }
+    }
+    return 0;
+}
+
+void ConstantPoolBuilder::insert(std::uint64_t entryHash, std::uint16_t index) {
+    if ((used + 1) * 4 > slots.size() * 3) {
+        grow();
+    }
+    auto mask = slots.size() - 1;
+    auto position = entryHash & mask;
+    while (slots[position] != 0) {
+        position = (position + 1) & mask;
+    }
+    slots[position] = (static_cast<std::uint32_t>(entryHash >> 48) << 16) | index;
+    used++;
+}
+
+void ConstantPoolBuilder::grow() {
+    // Slots only keep part of the hash, so every entry is hashed again from the pool
+    auto old = std::move(slots);
+    slots.assign(old.size() * 2, 0);
+    used = 0;
+    for (auto slot : old) {
+        if (slot != 0) {
+            auto index = static_cast<std::uint16_t>(slot);
+            insert(hash(pool->getTag(index), pool->getPayload(index)), index);
+        }
+    }
+}
+
+std::uint16_t ConstantPoolBuilder::add(ConstantPool::ConstantType tag, std::span<const std::uint8_t> payload) {
+    auto entryHash = hash(tag, payload);
+    if (auto index = find(entryHash, tag, payload)) {
+        return index;
+    }
+
+    // constant_pool_count is a u2, so the last entry must end below index 65535
+    std::size_t width = ConstantPool::isWide(tag) ? 2 : 1;
+    if (pool->getCount() + width > UINT16_MAX) {
+        throw std::length_error("Constant pool has no index left for another entry");
+    }
+    auto index = pool->add(tag, payload);
+    insert(entryHash, index);
+    return index;
+}
+
+std::uint16_t ConstantPoolBuilder::addIndex(ConstantPool::ConstantType tag, std::uint16_t index) {
+    std::uint8_t payload[2];
+    append16(payload, index);
+    return add(tag, payload);
+}
+
+std::uint16_t ConstantPoolBuilder::addIndexPair(ConstantPool::ConstantType tag, std::uint16_t first, std::uint16_t second) {
+    std::uint8_t payload[4];
+    append16(payload, first);
+    append16(payload + 2, second);
+    return add(tag, payload);
+}
+
+std::uint16_t ConstantPoolBuilder::addMemberRef(ConstantPool::ConstantType tag, std::string_view owner,
+                                                std::string_view name, std::string_view descriptor) {
+    auto classIndex = classRef(owner);
+    return addIndexPair(tag, classIndex, nameAndType(name, descriptor));
+}
+
+std::uint16_t ConstantPoolBuilder::utf8(std::string_view value) {
+    if (value.size() > UINT16_MAX) {
+        throw std::invalid_argument("UTF8 constant longer than 65535 bytes");
+    }
+    // The stored payload starts with the length
+    scratch.resize(2 + value.size());
+    append16(scratch.data(), static_cast<std::uint16_t>(value.size()));
+    std::copy(value.begin(), value.end(), scratch.begin() + 2);
+    return add(ConstantPool::CONSTANT_Utf8, scratch);
+}
+
+std::uint16_t ConstantPoolBuilder::classRef(std::string_view name) {
+    return addIndex(ConstantPool::CONSTANT_Class, utf8(name));
+}
+
+std::uint16_t ConstantPoolBuilder::string(std::string_view value) {
+    return addIndex(ConstantPool::CONSTANT_String, utf8(value));
+}
+
+std::uint16_t ConstantPoolBuilder::integer(std::int32_t value) {
+    std::uint8_t payload[4];
+    append32(payload, static_cast<std::uint32_t>(value));
+    return add(ConstantPool::CONSTANT_Integer, payload);
+}
+
+std::uint16_t ConstantPoolBuilder::floatingPoint(float value) {
+    std::uint8_t payload[4];
+    append32(payload, std::bit_cast<std::uint32_t>(value));
+    return add(ConstantPool::CONSTANT_Float, payload);
+}
+
+std::uint16_t ConstantPoolBuilder::longInteger(std::int64_t value) {
+    std::uint8_t payload[8];
+    append64(payload, static_cast<std::uint64_t>(value));
+    return add(ConstantPool::CONSTANT_Long, payload);
+}
+
+std::uint16_t ConstantPoolBuilder::doublePrecision(double value) {
+    std::uint8_t payload[8];
+    append64(payload, std::bit_cast<std::uint64_t>(value));
+    return add(ConstantPool::CONSTANT_Double, payload);
+}
+
+std::uint16_t ConstantPoolBuilder::nameAndType(std::string_view name, std::string_view descriptor) {
+    auto nameIndex = utf8(name);
+    return addIndexPair(ConstantPool::CONSTANT_NameAndType, nameIndex, utf8(descriptor));
+}
+
+std::uint16_t ConstantPoolBuilder::fieldRef(std::string_view owner, std::string_view name, std::string_view descriptor) {
+    return addMemberRef(ConstantPool::CONSTANT_Fieldref, owner, name, descriptor);
+}
+
+std::uint16_t ConstantPoolBuilder::methodRef(std::string_view owner, std::string_view name, std::string_view descriptor) {
+    return addMemberRef(ConstantPool::CONSTANT_Methodref, owner, name, descriptor);
+}
+
+std::uint16_t ConstantPoolBuilder::interfaceMethodRef(std::string_view owner, std::string_view name,
+                                                      std::string_view descriptor) {
+    return addMemberRef(ConstantPool::CONSTANT_InterfaceMethodref, owner, name, descriptor);
+}
+
+std::uint16_t ConstantPoolBuilder::methodHandle(std::uint8_t referenceKind, std::uint16_t referenceIndex) {
+    std::uint8_t payload[3];
+    payload[0] = referenceKind;
+    append16(payload + 1, referenceIndex);
+    return add(ConstantPool::CONSTANT_MethodHandle, payload);
+}
+
+std::uint16_t ConstantPoolBuilder::methodType(std::string_view descriptor) {
+    return addIndex(ConstantPool::CONSTANT_MethodType, utf8(descriptor));
+}
+
+std::uint16_t ConstantPoolBuilder::invokeDynamic(std::uint16_t bootstrapMethodAttrIndex, std::string_view name,
+                                                 std::string_view descriptor) {
+    return addIndexPair(ConstantPool::CONSTANT_InvokeDynamic, bootstrapMethodAttrIndex, nameAndType(name, descriptor));
+}
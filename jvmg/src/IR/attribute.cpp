@@ -3,48 +3,63 @@
 //
 #include "jvmg/IR/attribute.h"
 
+#include <stdexcept>
+
 using namespace jvmg;
 
-std::map<std::string, AttributeInfo::AttributeNameTag> AttributeInfo::attributeNameTagMap = {
-        {"ConstantValue", AttributeInfo::CONSTANT_VALUE},
-        {"Code", AttributeInfo::CODE},
-        {"StackMapTable", AttributeInfo::STACK_MAP_TABLE},
-        {"Exceptions", AttributeInfo::EXCEPTIONS},
-        {"InnerClasses", AttributeInfo::INNER_CLASSES},
-        {"EnclosingMethod", AttributeInfo::ENCLOSING_METHOD},
-        {"Synthetic", AttributeInfo::SYNTHETIC},
-        {"Signature", AttributeInfo::SIGNATURE},
-        {"SourceFile", AttributeInfo::SOURCE_FILE},
-        {"SourceDebugExtension", AttributeInfo::SOURCE_DEBUG_EXTENSION},
-        {"LineNumberTable", AttributeInfo::LINE_NUMBER_TABLE},
-        {"LocalVariableTable", AttributeInfo::LOCAL_VARIABLE_TABLE},
-        {"LocalVariableTypeTable", AttributeInfo::LOCAL_VARIABLE_TYPE_TABLE},
-        {"Deprecated", AttributeInfo::DEPRECATED},
-        {"RuntimeVisibleAnnotations", AttributeInfo::RUNTIME_VISIBLE_ANNOTATIONS},
-        {"RuntimeInvisibleAnnotations", AttributeInfo::RUNTIME_INVISIBLE_ANNOTATIONS},
-        {"RuntimeVisibleParamterAnnotations", AttributeInfo::RUNTIME_VISIBLE_PARAMETER_ANNOTATIONS},
-        {"RuntimeInvisibleParameterAnnotations", AttributeInfo::RUNTIME_INVISIBLE_PARAMETER_ANNOTATIONS},
-        {"AnnotationDefault", AttributeInfo::ANNOTATION_DEFAULT},
-        {"BootstrapMethods", AttributeInfo::BOOTSTRAP_METHODS}
-};
+namespace {
+    std::uint16_t readU2(std::span<const std::uint8_t> bytes, std::size_t offset) {
+        return static_cast<std::uint16_t>((bytes[offset] << 8) | bytes[offset + 1]);
+    }
+}
+
+bool AttributeInfo::contentsUnchanged() const {
+    // attribute_name_index and attribute_length take the first 6 bytes
+    return sourceU2(0) == attributeNameIndex && info->matchesInfo(getSource().subspan(6));
+}
+
+bool ConstantValueAttribute::matchesInfo(std::span<const std::uint8_t> info) const {
+    return info.size() == 2 && readU2(info, 0) == constantValueIndex;
+}
+
+bool SourceFileAttribute::matchesInfo(std::span<const std::uint8_t> info) const {
+    return info.size() == 2 && readU2(info, 0) == sourceFileIndex;
+}
 
+bool CodeAttribute::matchesInfo(std::span<const std::uint8_t> info) const {
+    if (isModified() || info.size() < 4 || readU2(info, 0) != maxStack || readU2(info, 2) != maxLocals) {
+        return false;
+    }
+    // Code is the only modelled attribute with attributes of its own. Until it is decoded nothing in it can
+    // have been changed.
+    return !isDecoded() || attributesUnchanged(attributesCount, attributes);
+}
 
 void CodeAttribute::_serialize() {
     serializeBytes(maxStack);
     serializeBytes(maxLocals);
-    serializeBytes(codeLength);
 
-    for (auto& inst : code) {
-        insertBytes(inst.serialize());
+    // Still undecoded, so nothing can have changed; write the original bytes back
+    if (!isDecoded()) {
+        serializeBytes(codeLength);
+        insertBytes(getBody());
+        return;
     }
 
-    serializeBytes(exceptionTableLength);
+    if (code.getCodeLength() > UINT32_MAX) {
+        throw std::length_error("Code array longer than 4 GiB");
+    }
+    codeLength = static_cast<std::uint32_t>(code.getCodeLength());
+    serializeBytes(codeLength);
+    insertBytes(code.getBytes());
+
+    serializeCount(exceptionTableLength, exceptionTable.size());
     for (auto& exception : exceptionTable) {
-        insertBytes(exception.serialize());
+        serializeChild(exception);
     }
 
-    serializeBytes(attributesCount);
+    serializeCount(attributesCount, attributes.size());
     for (auto& attribute : attributes) {
-        insertBytes(attribute->serialize());
+        serializeChild(*attribute);
     }
 }
\ No newline at end of file
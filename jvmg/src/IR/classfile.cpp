@@ -10,10 +10,10 @@ void ClassFile::FieldInfo::_serialize() {
     serializeBytes(accessFlags);
     serializeBytes(nameIndex);
     serializeBytes(descriptorIndex);
-    serializeBytes(attributesCount);
+    serializeCount(attributesCount, attributes.size());
 
     for (auto& attribute : attributes) {
-        insertBytes(attribute->serialize());
+        serializeChild(*attribute);
     }
 }
 
@@ -21,9 +21,9 @@ void ClassFile::MethodInfo::_serialize() {
     serializeBytes(accessFlags);
     serializeBytes(nameIndex);
     serializeBytes(descriptorIndex);
-    serializeBytes(attributesCount);
+    serializeCount(attributesCount, attributes.size());
     for (auto& attributeInfo : attributes) {
-        insertBytes(attributeInfo->serialize());
+        serializeChild(*attributeInfo);
     }
 }
 
@@ -32,32 +32,30 @@ void ClassFile::_serialize() {
     serializeBytes(minorVersion);
     serializeBytes(majorVersion);
 
-    serializeBytes(constantPoolCount);
-    for (auto& constant : constantPool) {
-        insertBytes(constant.serialize());
-    }
+    serializeCount(constantPoolCount, constantPool->getCount());
+    serializeChild(*constantPool);
 
     serializeBytes(accessFlags);
     serializeBytes(thisClass);
     serializeBytes(superClass);
 
-    serializeBytes(interfaceCount);
+    serializeCount(interfaceCount, interfaces.size());
     for (auto& interface : interfaces) {
         serializeBytes(interface);
     }
 
-    serializeBytes(fieldsCount);
+    serializeCount(fieldsCount, fields.size());
     for (auto& field : fields) {
-        insertBytes(field.serialize());
+        serializeChild(field);
     }
 
-    serializeBytes(methodsCount);
+    serializeCount(methodsCount, methods.size());
     for (auto& method : methods) {
-        insertBytes((method.serialize()));
+        serializeChild(method);
     }
 
-    serializeBytes(attributesCount);
+    serializeCount(attributesCount, attributes.size());
     for (auto& attribute : attributes) {
-        insertBytes(attribute->serialize());
+        serializeChild(*attribute);
     }
 }
\ No newline at end of file
@@ -0,0 +1,157 @@
+//
+// Created by Micky on 2/11/2024.
+//
+
+#include "jvmg/IR/instructionStream.h"
+#include "jvmg/IR/opcodeTable.h"
+
+#include <algorithm>
+
+using namespace jvmg;
+
+namespace {
+    std::int32_t readOperand(std::span<const std::uint8_t> bytes, std::size_t width, bool isSigned) {
+        std::uint32_t value = 0;
+        for (std::size_t i = 0; i < width; i++) {
+            value = (value << 8) | bytes[i];
+        }
+        if (isSigned && width < 4) {
+            // Sign-extend from the operand's width
+            auto shift = 32 - 8 * width;
+            return static_cast<std::int32_t>(value << shift) >> shift;
+        }
+        return static_cast<std::int32_t>(value);
+    }
+
+    std::int32_t decodeOperandWord(std::uint8_t opcodeByte, std::uint32_t bci, std::span<const std::uint8_t> operands) {
+        const OpcodeFormat &format = opcodeFormats[opcodeByte];
+        switch (format.layout) {
+            case OpcodeFormat::FIXED:
+                return format.firstOperandBytes == 0 ? 0 : readOperand(operands, format.firstOperandBytes, format.firstOperandSigned);
+            case OpcodeFormat::TABLESWITCH:
+            case OpcodeFormat::LOOKUPSWITCH: {
+                // The default offset follows the padding
+                auto padding = (4 - (bci + 1) % 4) % 4;
+                return operands.size() >= padding + 4 ? readOperand(operands.subspan(padding), 4, true) : 0;
+            }
+            case OpcodeFormat::WIDE:
+                return operands.size() >= 3 ? readOperand(operands.subspan(1), 2, false) : 0;
+            default:
+                return 0;
+        }
+    }
+}
+
+std::optional<InstructionView> InstructionView::decode(std::span<const std::uint8_t> code, std::uint32_t bci) {
+    if (bci >= code.size()) {
+        return std::nullopt;
+    }
+    auto opcodeByte = code[bci];
+    const OpcodeFormat &format = opcodeFormats[opcodeByte];
+    auto available = code.size() - bci - 1;
+
+    std::size_t length;
+    switch (format.layout) {
+        case OpcodeFormat::FIXED:
+            length = format.operandBytes;
+            break;
+        case OpcodeFormat::TABLESWITCH: {
+            auto padding = (4 - (bci + 1) % 4) % 4;
+            if (padding + 12 > available) {
+                return std::nullopt;
+            }
+            std::int64_t low = readOperand(code.subspan(bci + 1 + padding + 4), 4, true);
+            std::int64_t high = readOperand(code.subspan(bci + 1 + padding + 8), 4, true);
+            if (high < low) {
+                return std::nullopt;
+            }
+            length = padding + 12 + (high - low + 1) * 4;
+            break;
+        }
+        case OpcodeFormat::LOOKUPSWITCH: {
+            auto padding = (4 - (bci + 1) % 4) % 4;
+            if (padding + 8 > available) {
+                return std::nullopt;
+            }
+            std::int32_t nPairs = readOperand(code.subspan(bci + 1 + padding + 4), 4, true);
+            if (nPairs < 0) {
+                return std::nullopt;
+            }
+            length = padding + 8 + static_cast<std::size_t>(nPairs) * 8;
+            break;
+        }
+        case OpcodeFormat::WIDE:
+            if (available < 1) {
+                return std::nullopt;
+            }
+            length = code[bci + 1] == Instruction::IINC ? 5 : 3;
+            break;
+        case OpcodeFormat::INVALID:
+        default:
+            return std::nullopt;
+    }
+    if (length > available) {
+        return std::nullopt;
+    }
+
+    auto operands = code.subspan(bci + 1, length);
+    return InstructionView(opcodeByte, bci, decodeOperandWord(opcodeByte, bci, operands), operands);
+}
+
+Instruction::Type InstructionView::getType() const {
+    return opcodeFormats[opcodeByte].type;
+}
+
+std::optional<Instruction::ImplicitValue> InstructionView::getImplicitValue() const {
+    const OpcodeFormat &format = opcodeFormats[opcodeByte];
+    if (!format.hasImplicitValue) {
+        return std::nullopt;
+    }
+    return format.implicitValue;
+}
+
+Instruction InstructionView::toInstruction() const {
+    return {opcodeByte, {operands.begin(), operands.end()}, getType(), getImplicitValue()};
+}
+
+InstructionStream::InstructionStream(const std::vector<Instruction> &instructions) {
+    reserve(instructions.size(), instructions.size() * 3);
+    for (const auto &instruction : instructions) {
+        append(instruction);
+    }
+}
+
+void InstructionStream::reserve(std::size_t instructionCount, std::size_t codeLength) {
+    opcodes.reserve(instructionCount);
+    bcis.reserve(instructionCount);
+    operandWords.reserve(instructionCount);
+    code.reserve(codeLength);
+}
+
+void InstructionStream::append(std::uint8_t opcodeByte, std::span<const std::uint8_t> operands) {
+    auto bci = static_cast<std::uint32_t>(code.size());
+    opcodes.push_back(opcodeByte);
+    bcis.push_back(bci);
+    operandWords.push_back(decodeOperandWord(opcodeByte, bci, operands));
+    code.push_back(opcodeByte);
+    code.insert(code.end(), operands.begin(), operands.end());
+}
+
+void InstructionStream::append(const Instruction &instruction) {
+    auto operands = instruction.getOperands();
+    append(instruction.getOpcodeByte(), operands);
+}
+
+InstructionView InstructionStream::operator[](std::size_t index) const {
+    auto bci = bcis[index];
+    auto next = index + 1 < bcis.size() ? bcis[index + 1] : static_cast<std::uint32_t>(code.size());
+    return {opcodes[index], bci, operandWords[index], std::span<const std::uint8_t>(code).subspan(bci + 1, next - bci - 1)};
+}
+
+std::optional<std::size_t> InstructionStream::indexOfBci(std::uint32_t bci) const {
+    auto it = std::lower_bound(bcis.begin(), bcis.end(), bci);
+    if (it == bcis.end() || *it != bci) {
+        return std::nullopt;
+    }
+    return it - bcis.begin();
+}
@@ -0,0 +1,398 @@
+//
+// Created by Micky on 2/3/2024.
+//
+
+#include "jvmg/archive/inflate.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+using namespace jvmg;
+
+namespace {
+    constexpr int MAX_BITS = 15;
+    constexpr int MAX_LITLEN_CODES = 288;
+    constexpr int MAX_DIST_CODES = 32;
+    constexpr int MAX_CODE_LENGTH_CODES = 19;
+
+    // Codes up to FAST_BITS long are resolved with one table load, longer ones walk the canonical code
+    constexpr int FAST_BITS = 10;
+    constexpr std::uint32_t FAST_MASK = (1u << FAST_BITS) - 1;
+
+    // Class files usually deflate to a third of their size or more, so most outputs need no growing
+    constexpr std::size_t TYPICAL_EXPANSION = 4;
+
+    constexpr std::array<std::uint16_t, 29> lengthBase = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+    };
+    constexpr std::array<std::uint8_t, 29> lengthExtra = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+    };
+    constexpr std::array<std::uint16_t, 30> distBase = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+    };
+    constexpr std::array<std::uint8_t, 30> distExtra = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+    };
+    constexpr std::array<std::uint8_t, MAX_CODE_LENGTH_CODES> codeLengthOrder = {
+            16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+    };
+
+    struct HuffmanTable {
+        // fast[bits] = symbol << 4 | length, or 0 if the code is longer than FAST_BITS
+        std::array<std::uint16_t, 1 << FAST_BITS> fast;
+        std::array<std::uint16_t, MAX_BITS + 1> counts;
+        std::array<std::uint16_t, MAX_LITLEN_CODES> symbols;
+
+        void build(const std::uint8_t *lengths, int n) {
+            counts.fill(0);
+            for (int i = 0; i < n; i++) {
+                counts[lengths[i]]++;
+            }
+            counts[0] = 0;
+
+            int left = 1;
+            for (int len = 1; len <= MAX_BITS; len++) {
+                left <<= 1;
+                left -= counts[len];
+                if (left < 0) {
+                    throw std::runtime_error("Invalid deflate stream: over-subscribed Huffman code");
+                }
+            }
+
+            std::array<std::uint16_t, MAX_BITS + 2> offsets{};
+            std::array<std::uint16_t, MAX_BITS + 1> nextCode{};
+            int code = 0;
+            for (int len = 1; len <= MAX_BITS; len++) {
+                offsets[len + 1] = offsets[len] + counts[len];
+                code = (code + counts[len - 1]) << 1;
+                nextCode[len] = code;
+            }
+
+            fast.fill(0);
+            for (int symbol = 0; symbol < n; symbol++) {
+                int len = lengths[symbol];
+                if (len == 0) {
+                    continue;
+                }
+                symbols[offsets[len]++] = symbol;
+
+                if (len <= FAST_BITS) {
+                    // Deflate packs Huffman codes starting from their most significant bit
+                    std::uint32_t reversed = 0;
+                    std::uint32_t canonical = nextCode[len];
+                    for (int i = 0; i < len; i++) {
+                        reversed = (reversed << 1) | ((canonical >> i) & 1);
+                    }
+                    for (std::uint32_t i = reversed; i < (1u << FAST_BITS); i += (1u << len)) {
+                        fast[i] = static_cast<std::uint16_t>(symbol << 4 | len);
+                    }
+                }
+                nextCode[len]++;
+            }
+        }
+    };
+
+    struct FixedTables {
+        HuffmanTable litLen;
+        HuffmanTable dist;
+
+        FixedTables() {
+            std::array<std::uint8_t, MAX_LITLEN_CODES> lengths{};
+            for (int i = 0; i < MAX_LITLEN_CODES; i++) {
+                lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+            }
+            litLen.build(lengths.data(), MAX_LITLEN_CODES);
+
+            lengths.fill(5);
+            dist.build(lengths.data(), MAX_DIST_CODES);
+        }
+    };
+
+    class InflateState {
+    public:
+        InflateState(std::span<const std::uint8_t> src, std::span<std::uint8_t> dst)
+            : src(src), dst(dst), expectedSize(dst.size()) {}
+
+        // Writes into growable, which grows as output is produced until it holds expectedSize bytes
+        InflateState(std::span<const std::uint8_t> src, std::vector<std::uint8_t> &growable, std::size_t expectedSize)
+            : src(src), dst(growable), growable(&growable), expectedSize(expectedSize) {}
+
+        void run() {
+            bool final;
+            do {
+                final = bits(1);
+                switch (bits(2)) {
+                    case 0:
+                        storedBlock();
+                        break;
+                    case 1: {
+                        static const FixedTables fixedTables;
+                        codesBlock(fixedTables.litLen, fixedTables.dist);
+                        break;
+                    }
+                    case 2:
+                        dynamicBlock();
+                        break;
+                    default:
+                        throw std::runtime_error("Invalid deflate stream: reserved block type");
+                }
+                checkTruncated();
+            } while (!final);
+
+            if (outPos != expectedSize) {
+                throw std::runtime_error("Invalid deflate stream: size does not match the archive directory");
+            }
+        }
+
+    private:
+        // Makes room for count more bytes of output, growing a vector output by at least half up to expectedSize
+        void reserveOutput(std::size_t count) {
+            if (count <= dst.size() - outPos) {
+                return;
+            }
+            if (growable == nullptr || count > expectedSize - outPos) {
+                throw std::runtime_error("Invalid deflate stream: output larger than expected");
+            }
+            growable->resize(std::min(expectedSize, std::max(outPos + count, dst.size() + dst.size() / 2)));
+            dst = *growable;
+        }
+
+        // Keeps at least 56 bits buffered, which covers the longest length/distance pair in one refill.
+        // Reading past the end feeds zeros; checkTruncated() rejects streams that actually used them.
+        void refill() {
+            while (bitCount <= 56) {
+                std::uint64_t byte = inPos < src.size() ? src[inPos] : 0;
+                inPos++;
+                bitBuf |= byte << bitCount;
+                bitCount += 8;
+            }
+        }
+
+        std::uint32_t bits(int n) {
+            if (bitCount < n) {
+                refill();
+            }
+            auto value = static_cast<std::uint32_t>(bitBuf & ((1ull << n) - 1));
+            bitBuf >>= n;
+            bitCount -= n;
+            return value;
+        }
+
+        void checkTruncated() const {
+            if (inPos > src.size() && static_cast<std::size_t>(inPos - src.size()) > static_cast<std::size_t>(bitCount / 8)) {
+                throw std::runtime_error("Invalid deflate stream: unexpected end of input");
+            }
+        }
+
+        int decode(const HuffmanTable &table) {
+            if (bitCount < MAX_BITS) {
+                refill();
+            }
+            std::uint16_t entry = table.fast[bitBuf & FAST_MASK];
+            if (entry != 0) {
+                bitBuf >>= entry & 0xF;
+                bitCount -= entry & 0xF;
+                return entry >> 4;
+            }
+
+            int code = 0;
+            int first = 0;
+            int index = 0;
+            for (int len = 1; len <= MAX_BITS; len++) {
+                code |= static_cast<int>((bitBuf >> (len - 1)) & 1);
+                int count = table.counts[len];
+                if (code - count < first) {
+                    bitBuf >>= len;
+                    bitCount -= len;
+                    return table.symbols[index + (code - first)];
+                }
+                index += count;
+                first += count;
+                first <<= 1;
+                code <<= 1;
+            }
+            throw std::runtime_error("Invalid deflate stream: bad Huffman code");
+        }
+
+        void storedBlock() {
+            // Drop to a byte boundary and hand the buffered whole bytes back to the input
+            bitBuf = 0;
+            inPos -= bitCount / 8;
+            bitCount = 0;
+
+            if (inPos + 4 > src.size()) {
+                throw std::runtime_error("Invalid deflate stream: unexpected end of input");
+            }
+            std::uint16_t len = src[inPos] | (src[inPos + 1] << 8);
+            std::uint16_t nlen = src[inPos + 2] | (src[inPos + 3] << 8);
+            inPos += 4;
+            if (len != static_cast<std::uint16_t>(~nlen)) {
+                throw std::runtime_error("Invalid deflate stream: stored block length mismatch");
+            }
+            if (inPos + len > src.size()) {
+                throw std::runtime_error("Invalid deflate stream: unexpected end of input");
+            }
+            reserveOutput(len);
+            std::memcpy(dst.data() + outPos, src.data() + inPos, len);
+            inPos += len;
+            outPos += len;
+        }
+
+        void dynamicBlock() {
+            int nlen = static_cast<int>(bits(5)) + 257;
+            int ndist = static_cast<int>(bits(5)) + 1;
+            int ncode = static_cast<int>(bits(4)) + 4;
+            if (nlen > 286 || ndist > 30) {
+                throw std::runtime_error("Invalid deflate stream: bad code counts");
+            }
+
+            std::array<std::uint8_t, MAX_LITLEN_CODES + MAX_DIST_CODES> lengths{};
+            for (int i = 0; i < ncode; i++) {
+                lengths[codeLengthOrder[i]] = bits(3);
+            }
+            codeLengthTable.build(lengths.data(), MAX_CODE_LENGTH_CODES);
+
+            lengths.fill(0);
+            int index = 0;
+            while (index < nlen + ndist) {
+                int symbol = decode(codeLengthTable);
+                if (symbol < 16) {
+                    lengths[index++] = symbol;
+                    continue;
+                }
+
+                std::uint8_t len = 0;
+                int repeat;
+                if (symbol == 16) {
+                    if (index == 0) {
+                        throw std::runtime_error("Invalid deflate stream: repeat with no previous length");
+                    }
+                    len = lengths[index - 1];
+                    repeat = 3 + static_cast<int>(bits(2));
+                } else if (symbol == 17) {
+                    repeat = 3 + static_cast<int>(bits(3));
+                } else {
+                    repeat = 11 + static_cast<int>(bits(7));
+                }
+                if (index + repeat > nlen + ndist) {
+                    throw std::runtime_error("Invalid deflate stream: too many code lengths");
+                }
+                while (repeat--) {
+                    lengths[index++] = len;
+                }
+            }
+
+            if (lengths[256] == 0) {
+                throw std::runtime_error("Invalid deflate stream: missing end-of-block code");
+            }
+
+            litLenTable.build(lengths.data(), nlen);
+            distTable.build(lengths.data() + nlen, ndist);
+            codesBlock(litLenTable, distTable);
+        }
+
+        void codesBlock(const HuffmanTable &litLen, const HuffmanTable &dist) {
+            while (true) {
+                refill();
+                int symbol = decode(litLen);
+                if (symbol < 256) {
+                    if (outPos >= dst.size()) {
+                        reserveOutput(1);
+                    }
+                    dst[outPos++] = static_cast<std::uint8_t>(symbol);
+                    continue;
+                }
+                if (symbol == 256) {
+                    return;
+                }
+
+                symbol -= 257;
+                if (symbol >= 29) {
+                    throw std::runtime_error("Invalid deflate stream: bad length symbol");
+                }
+                std::size_t len = lengthBase[symbol] + bits(lengthExtra[symbol]);
+
+                int distSymbol = decode(dist);
+                if (distSymbol >= 30) {
+                    throw std::runtime_error("Invalid deflate stream: bad distance symbol");
+                }
+                std::size_t distance = distBase[distSymbol] + bits(distExtra[distSymbol]);
+
+                if (distance > outPos) {
+                    throw std::runtime_error("Invalid deflate stream: distance too far back");
+                }
+                if (len > dst.size() - outPos) {
+                    reserveOutput(len);
+                }
+
+                std::uint8_t *out = dst.data() + outPos;
+                const std::uint8_t *from = out - distance;
+                if (distance >= len) {
+                    std::memcpy(out, from, len);
+                } else {
+                    // Overlapping copy repeats the last distance bytes
+                    for (std::size_t i = 0; i < len; i++) {
+                        out[i] = from[i];
+                    }
+                }
+                outPos += len;
+            }
+        }
+
+        std::span<const std::uint8_t> src;
+        std::span<std::uint8_t> dst;
+        std::vector<std::uint8_t> *growable = nullptr;
+        std::size_t expectedSize;
+        std::size_t inPos = 0;
+        std::size_t outPos = 0;
+
+        std::uint64_t bitBuf = 0;
+        int bitCount = 0;
+
+        HuffmanTable codeLengthTable;
+        HuffmanTable litLenTable;
+        HuffmanTable distTable;
+    };
+
+    constexpr std::array<std::uint32_t, 256> crcTable = [] {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+}
+
+void Inflater::inflate(std::span<const std::uint8_t> src, std::span<std::uint8_t> dst) {
+    InflateState state(src, dst);
+    state.run();
+}
+
+void Inflater::inflate(std::span<const std::uint8_t> src, std::vector<std::uint8_t> &dst, std::size_t uncompressedSize) {
+    if (uncompressedSize / MAX_EXPANSION > src.size()) {
+        throw std::runtime_error("Invalid deflate stream: uncompressed size beyond what the input can expand to");
+    }
+    // Start from whatever capacity is left over from earlier entries, so that reuse costs no allocation
+    dst.resize(std::min(uncompressedSize, std::max(dst.capacity(), src.size() * TYPICAL_EXPANSION)));
+    InflateState state(src, dst, uncompressedSize);
+    state.run();
+}
+
+std::uint32_t jvmg::crc32(std::span<const std::uint8_t> bytes, std::uint32_t crc) {
+    crc = ~crc;
+    for (auto byte : bytes) {
+        crc = crcTable[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,214 @@
+//
+// Created by Micky on 2/3/2024.
+//
+
+#include "jvmg/archive/jarReader.h"
+#include "jvmg/archive/inflate.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace jvmg;
+
+namespace {
+    constexpr std::uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+    constexpr std::uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014B50;
+    constexpr std::uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054B50;
+    constexpr std::uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064B50;
+    constexpr std::uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064B50;
+    constexpr std::uint16_t ZIP64_EXTRA_FIELD_ID = 0x0001;
+
+    constexpr std::size_t LOCAL_HEADER_SIZE = 30;
+    constexpr std::size_t CENTRAL_HEADER_SIZE = 46;
+    constexpr std::size_t END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+    constexpr std::size_t ZIP64_LOCATOR_SIZE = 20;
+    constexpr std::size_t MAX_COMMENT_SIZE = 0xFFFF;
+
+    constexpr std::uint16_t FLAG_ENCRYPTED = 0x0001;
+
+    // ZIP fields are little-endian, unlike the class file format
+    template<typename T>
+    T readLittleEndian(std::span<const std::uint8_t> bytes, std::size_t offset) {
+        // Offsets come from the archive itself, so offset + sizeof(T) could wrap around
+        if (offset > bytes.size() || sizeof(T) > bytes.size() - offset) {
+            throw std::runtime_error("Corrupt archive: field past end of file");
+        }
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        if constexpr (std::endian::native == std::endian::big) {
+            value = std::byteswap(value);
+        }
+        return value;
+    }
+
+    std::uint16_t readU2(std::span<const std::uint8_t> bytes, std::size_t offset) {
+        return readLittleEndian<std::uint16_t>(bytes, offset);
+    }
+
+    std::uint32_t readU4(std::span<const std::uint8_t> bytes, std::size_t offset) {
+        return readLittleEndian<std::uint32_t>(bytes, offset);
+    }
+
+    std::uint64_t readU8(std::span<const std::uint8_t> bytes, std::size_t offset) {
+        return readLittleEndian<std::uint64_t>(bytes, offset);
+    }
+}
+
+JarReader::JarReader(const std::string &filename) : reader(new Reader(filename)) {
+    archive = reader->getBuffer();
+    if (reader->getBackend() == Reader::STREAM) {
+        // The directory is at the end of the file, so without a mapping the archive has to be loaded
+        auto bytes = reader->readBytes(std::filesystem::file_size(filename));
+        fileBytes.assign(bytes.begin(), bytes.end());
+        delete reader;
+        reader = nullptr;
+        archive = fileBytes;
+    }
+    readCentralDirectory();
+}
+
+JarReader::JarReader(std::span<const std::uint8_t> bytes) : reader(nullptr), archive(bytes) {
+    readCentralDirectory();
+}
+
+JarReader::~JarReader() {
+    delete reader;
+}
+
+void JarReader::readCentralDirectory() {
+    if (archive.size() < END_OF_CENTRAL_DIRECTORY_SIZE) {
+        throw std::runtime_error("Corrupt archive: too small to be a ZIP file");
+    }
+
+    // The end of central directory record sits before an optional trailing comment of up to 64 KiB
+    std::size_t eocd = archive.size() - END_OF_CENTRAL_DIRECTORY_SIZE;
+    std::size_t searchLimit = eocd > MAX_COMMENT_SIZE ? eocd - MAX_COMMENT_SIZE : 0;
+    while (readU4(archive, eocd) != END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+        if (eocd == searchLimit) {
+            throw std::runtime_error("Corrupt archive: end of central directory not found");
+        }
+        eocd--;
+    }
+
+    std::uint64_t entryCount = readU2(archive, eocd + 10);
+    std::uint64_t directoryOffset = readU4(archive, eocd + 16);
+
+    if ((entryCount == 0xFFFF || directoryOffset == 0xFFFFFFFF) && eocd >= ZIP64_LOCATOR_SIZE
+        && readU4(archive, eocd - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR_SIGNATURE) {
+        std::uint64_t zip64Eocd = readU8(archive, eocd - ZIP64_LOCATOR_SIZE + 8);
+        if (zip64Eocd > archive.size() || readU4(archive, zip64Eocd) != ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+            throw std::runtime_error("Corrupt archive: bad ZIP64 end of central directory");
+        }
+        entryCount = readU8(archive, zip64Eocd + 32);
+        directoryOffset = readU8(archive, zip64Eocd + 48);
+    }
+
+    if (directoryOffset > archive.size()) {
+        throw std::runtime_error("Corrupt archive: central directory past end of file");
+    }
+
+    entries.clear();
+    // The count is untrusted, but every entry takes at least a header
+    entries.reserve(std::min<std::uint64_t>(entryCount, archive.size() / CENTRAL_HEADER_SIZE));
+
+    std::size_t offset = directoryOffset;
+    for (std::uint64_t i = 0; i < entryCount; i++) {
+        if (readU4(archive, offset) != CENTRAL_HEADER_SIGNATURE) {
+            throw std::runtime_error("Corrupt archive: bad central directory header");
+        }
+
+        std::uint16_t nameLength = readU2(archive, offset + 28);
+        std::uint16_t extraLength = readU2(archive, offset + 30);
+        std::uint16_t commentLength = readU2(archive, offset + 32);
+        std::size_t nameOffset = offset + CENTRAL_HEADER_SIZE;
+        if (nameOffset + nameLength + extraLength > archive.size()) {
+            throw std::runtime_error("Corrupt archive: central directory header past end of file");
+        }
+
+        Entry entry{
+                std::string(reinterpret_cast<const char *>(archive.data() + nameOffset), nameLength),
+                readU2(archive, offset + 8),
+                readU2(archive, offset + 10),
+                readU4(archive, offset + 16),
+                readU4(archive, offset + 20),
+                readU4(archive, offset + 24),
+                readU4(archive, offset + 42)
+        };
+
+        // ZIP64 extra field holds the 64-bit versions of whichever fields were saturated, in this order
+        std::size_t extra = nameOffset + nameLength;
+        std::size_t extraEnd = extra + extraLength;
+        while (extra + 4 <= extraEnd) {
+            std::uint16_t id = readU2(archive, extra);
+            std::uint16_t size = readU2(archive, extra + 2);
+            if (id == ZIP64_EXTRA_FIELD_ID) {
+                std::size_t field = extra + 4;
+                if (entry.uncompressedSize == 0xFFFFFFFF) {
+                    entry.uncompressedSize = readU8(archive, field);
+                    field += 8;
+                }
+                if (entry.compressedSize == 0xFFFFFFFF) {
+                    entry.compressedSize = readU8(archive, field);
+                    field += 8;
+                }
+                if (entry.localHeaderOffset == 0xFFFFFFFF) {
+                    entry.localHeaderOffset = readU8(archive, field);
+                }
+            }
+            extra += 4 + size;
+        }
+
+        entries.push_back(std::move(entry));
+        offset = extraEnd + commentLength;
+    }
+}
+
+std::span<const std::uint8_t> JarReader::readEntry(const Entry &entry, std::vector<std::uint8_t> &buffer) const {
+    if (entry.flags & FLAG_ENCRYPTED) {
+        throw std::runtime_error("Encrypted archive entries are not supported: " + entry.name);
+    }
+
+    // The local header repeats the name and may carry a different extra field, so its length is re-read here
+    if (entry.localHeaderOffset > archive.size()) {
+        throw std::runtime_error("Corrupt archive: local header past end of file for " + entry.name);
+    }
+    std::size_t header = entry.localHeaderOffset;
+    if (readU4(archive, header) != LOCAL_HEADER_SIGNATURE) {
+        throw std::runtime_error("Corrupt archive: bad local header for " + entry.name);
+    }
+    std::size_t dataOffset = header + LOCAL_HEADER_SIZE + readU2(archive, header + 26) + readU2(archive, header + 28);
+    if (dataOffset > archive.size() || entry.compressedSize > archive.size() - dataOffset) {
+        throw std::runtime_error("Corrupt archive: entry data past end of file for " + entry.name);
+    }
+    auto compressed = archive.subspan(dataOffset, entry.compressedSize);
+
+    std::span<const std::uint8_t> bytes;
+    switch (entry.compressionMethod) {
+        case STORED:
+            if (entry.compressedSize != entry.uncompressedSize) {
+                throw std::runtime_error("Corrupt archive: stored entry size mismatch for " + entry.name);
+            }
+            bytes = compressed;
+            break;
+        case DEFLATED:
+            Inflater::inflate(compressed, buffer, entry.uncompressedSize);
+            bytes = buffer;
+            break;
+        default:
+            throw std::runtime_error("Unsupported compression method " + std::to_string(entry.compressionMethod)
+                                     + " for " + entry.name);
+    }
+
+    if (crc32(bytes) != entry.crc32) {
+        throw std::runtime_error("Corrupt archive: CRC mismatch for " + entry.name);
+    }
+    return bytes;
+}
+
+void JarReader::forEachClass(const ClassCallback &callback) {
+    for (const auto &entry : entries) {
+        if (entry.isClass()) {
+            callback(entry, readEntry(entry, scratch));
+        }
+    }
+}
@@ -0,0 +1,102 @@
+//
+// Created by Micky on 2/5/2024.
+//
+
+#include "jvmg/parser/batchParser.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <optional>
+
+using namespace jvmg;
+
+std::vector<ClassFile> BatchParser::parseFiles(const std::vector<std::string> &filenames) {
+    return collect(filenames.size(), [&](const Callback &callback) { parseFiles(filenames, callback); });
+}
+
+std::vector<ClassFile> BatchParser::parseBuffers(const std::vector<std::span<const std::uint8_t>> &buffers) {
+    return collect(buffers.size(), [&](const Callback &callback) { parseBuffers(buffers, callback); });
+}
+
+void BatchParser::parseFiles(const std::vector<std::string> &filenames, const Callback &callback) {
+    std::vector<std::size_t> sizes;
+    sizes.reserve(filenames.size());
+    for (const auto &filename : filenames) {
+        std::error_code error;
+        auto size = std::filesystem::file_size(filename, error);
+        sizes.push_back(error ? 0 : size);
+    }
+
+    run(sizes, [&](std::size_t index) {
+        Reader reader(filenames[index]);
+        Parser parser(&reader);
+        return parser.consumeClassFile();
+    }, callback);
+}
+
+void BatchParser::parseBuffers(const std::vector<std::span<const std::uint8_t>> &buffers, const Callback &callback) {
+    std::vector<std::size_t> sizes;
+    sizes.reserve(buffers.size());
+    for (const auto &buffer : buffers) {
+        sizes.push_back(buffer.size());
+    }
+
+    run(sizes, [&](std::size_t index) {
+        Parser parser(buffers[index]);
+        return parser.consumeClassFile();
+    }, callback);
+}
+
+std::vector<ClassFile> BatchParser::parseFiles(const std::vector<std::string> &filenames, FileLoader &loader) {
+    return collect(filenames.size(), [&](const Callback &callback) { parseFiles(filenames, loader, callback); });
+}
+
+void BatchParser::parseFiles(const std::vector<std::string> &filenames, FileLoader &loader, const Callback &callback) {
+    try {
+        loader.load(filenames, [this, &callback](std::size_t index, std::vector<std::uint8_t> &&bytes) {
+            auto buffer = std::make_shared<std::vector<std::uint8_t>>(std::move(bytes));
+            pool.submit([buffer, index, &callback] {
+                Parser parser{std::span<const std::uint8_t>(*buffer), buffer};
+                callback(index, parser.consumeClassFile());
+            });
+        });
+    } catch (...) {
+        // Let the already queued parses finish before the callback goes out of scope
+        try {
+            pool.wait();
+        } catch (...) {}
+        throw;
+    }
+    pool.wait();
+}
+
+void BatchParser::run(const std::vector<std::size_t> &sizes, const std::function<ClassFile(std::size_t)> &parse,
+                      const Callback &callback) {
+    // Longest-first: the big classes start early and the small ones fill in the gaps at the end
+    std::vector<std::size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return sizes[a] > sizes[b]; });
+
+    for (auto index : order) {
+        pool.submit([&parse, &callback, index] {
+            callback(index, parse(index));
+        });
+    }
+    pool.wait();
+}
+
+std::vector<ClassFile> BatchParser::collect(std::size_t count, const std::function<void(const Callback &)> &parseAll) {
+    // Each slot is written by exactly one task, so no locking is needed
+    std::vector<std::optional<ClassFile>> slots(count);
+    parseAll([&slots](std::size_t index, ClassFile &&classFile) {
+        slots[index].emplace(std::move(classFile));
+    });
+
+    std::vector<ClassFile> results;
+    results.reserve(count);
+    for (auto &slot : slots) {
+        results.push_back(std::move(*slot));
+    }
+    return results;
+}
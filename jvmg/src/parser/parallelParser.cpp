@@ -0,0 +1,164 @@
+//
+// Created by Micky on 2/17/2024.
+//
+
+#include "jvmg/parser/parser.h"
+#include "jvmg/util/threadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+using namespace jvmg;
+
+namespace {
+    // Shared with the helper tasks, which may only start running after the parse that submitted them has
+    // returned. Such late helpers find no method left to claim and touch nothing but this state.
+    struct MethodDecodeState {
+        std::span<const std::uint8_t> input;
+        std::shared_ptr<const void> owner;
+        std::shared_ptr<const ConstantPool> constantPool;
+        std::uint32_t options = 0;
+        // Offset of each method_info in input
+        std::vector<std::size_t> starts;
+
+        std::vector<std::optional<ClassFile::MethodInfo>> methods;
+        std::vector<std::optional<ParseError>> errors;
+        std::exception_ptr exception;
+
+        std::atomic<std::size_t> next = 0;
+        std::mutex mutex;
+        std::condition_variable allDone;
+        std::size_t doneCount = 0;
+    };
+
+    void deleteAttributes(ClassFile::MethodInfo &methodInfo) {
+        for (auto *attribute : methodInfo.attributes) {
+            delete attribute;
+        }
+        methodInfo.attributes.clear();
+    }
+}
+
+bool Parser::consumeMethodsInParallel(std::uint16_t methodsCount, std::vector<ClassFile::MethodInfo> &methods) {
+    auto input = reader->getBuffer();
+    if (threadPool == nullptr || input.empty() || methodsCount == 0 || error) {
+        return false;
+    }
+    // The methods section cannot be longer than what is left of the input, so most small classes can be left to
+    // the sequential loop without paying for the scan
+    if (input.size() - reader->getOffset() < parallelMethodsBytes) {
+        return false;
+    }
+
+    auto state = std::make_shared<MethodDecodeState>();
+    auto contextStart = context->getByteOffset();
+
+    // Skip-scan: only the member headers and attribute lengths are read, to find where each method starts
+    state->starts.reserve(methodsCount);
+    for (int i = 0; i < methodsCount && !error; i++) {
+        state->starts.push_back(reader->getOffset());
+        // access_flags, name_index and descriptor_index
+        skipBytes(6);
+        std::uint16_t attributesCount = consumeTwoBytes();
+        for (int j = 0; j < attributesCount && !error; j++) {
+            skipBytes(2);
+            skipBytes(consumeFourBytes());
+        }
+    }
+    // A failed scan still decodes the methods it found, since one of them may fail earlier in the input than
+    // the scan did
+    auto scanError = error;
+    auto sectionLength = reader->getOffset() - state->starts.front();
+    if (sectionLength < parallelMethodsBytes) {
+        // Too small to split after all: go back to the first method and let the sequential loop decode them
+        reader->rewind(state->starts.front());
+        context->incrementByteOffset(contextStart - context->getByteOffset());
+        error.reset();
+        return false;
+    }
+
+    state->input = input;
+    state->owner = reader->getOwner();
+    state->constantPool = context->getConstantPool();
+    state->options = options;
+    state->methods.resize(state->starts.size());
+    state->errors.resize(state->starts.size());
+
+    // Each method gets its own Parser and ParserContext, so byte and code offsets are never shared. Each reads
+    // from where its method starts to the end of the input, exactly as a sequential parse would, so errors and
+    // switch padding come out the same.
+    auto contextOffset = context->getByteOffset() - static_cast<long long>(reader->getOffset());
+    auto decodeMethods = [contextOffset](MethodDecodeState &state) {
+        std::size_t index;
+        while ((index = state.next++) < state.methods.size()) {
+            try {
+                auto start = state.starts[index];
+                auto *methodContext = new ParserContext(state.constantPool);
+                methodContext->incrementByteOffset(contextOffset + static_cast<long long>(start));
+                Parser parser(state.input.subspan(start), state.owner, methodContext);
+                parser.options = state.options;
+                auto methodInfo = parser.consumeMethodInfo();
+                if (parser.error) {
+                    state.errors[index] = parser.error;
+                    deleteAttributes(methodInfo);
+                } else {
+                    state.methods[index].emplace(std::move(methodInfo));
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (!state.exception) {
+                    state.exception = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (++state.doneCount == state.methods.size()) {
+                state.allDone.notify_all();
+            }
+        }
+    };
+
+    unsigned helperCount = std::min<unsigned>(threadPool->getThreadCount(), state->methods.size() - 1);
+    for (unsigned i = 0; i < helperCount; i++) {
+        threadPool->submit([state, decodeMethods] { decodeMethods(*state); });
+    }
+    decodeMethods(*state);
+
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->allDone.wait(lock, [&] { return state->doneCount == state->methods.size(); });
+    }
+    // Methods are only handed over when every one of them was decoded; otherwise their attributes, which
+    // nothing else owns, are freed here
+    auto discardMethods = [&state] {
+        for (auto &methodInfo : state->methods) {
+            if (methodInfo) {
+                deleteAttributes(*methodInfo);
+            }
+        }
+    };
+    if (state->exception) {
+        discardMethods();
+        std::rethrow_exception(state->exception);
+    }
+
+    // The first method in file order to fail is the error a sequential parse would have reported
+    for (auto &methodError : state->errors) {
+        if (methodError) {
+            error = methodError;
+            discardMethods();
+            return true;
+        }
+    }
+    if (scanError) {
+        discardMethods();
+        return true;
+    }
+    methods.reserve(methodsCount);
+    for (auto &methodInfo : state->methods) {
+        methods.push_back(std::move(*methodInfo));
+    }
+    return true;
+}
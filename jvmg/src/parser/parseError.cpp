@@ -0,0 +1,45 @@
+//
+// Created by Micky on 2/14/2024.
+//
+
+#include "jvmg/parser/parseError.h"
+
+#include <stdexcept>
+
+using namespace jvmg;
+
+std::string_view ParseError::getDescription() const {
+    switch (reason) {
+        case TRUNCATED:
+            return "Unexpected end of input";
+        case BAD_MAGIC:
+            return "Not a class file";
+        case BAD_CONSTANT_TAG:
+            return "Constant pool info tag invalid";
+        case BAD_UTF8:
+            return "Malformed modified UTF-8";
+        case BAD_CONSTANT_INDEX:
+            return "Constant pool index out of range or not a Utf8 entry";
+        case BAD_LENGTH:
+            return "Length out of range";
+        case BAD_INSTRUCTION:
+            return "Invalid instruction";
+        default:
+            return "Invalid class file";
+    }
+}
+
+std::string ParseError::toString() const {
+    return std::string(getDescription()) + " at byte " + std::to_string(offset);
+}
+
+std::exception_ptr jvmg::makeParseException(const ParseError &error) {
+    if (error.reason == ParseError::TRUNCATED) {
+        return std::make_exception_ptr(std::out_of_range(error.toString()));
+    }
+    return std::make_exception_ptr(std::invalid_argument(error.toString()));
+}
+
+void jvmg::throwParseError(const ParseError &error) {
+    std::rethrow_exception(makeParseException(error));
+}
@@ -1,46 +1,67 @@
 #include "jvmg/parser/parser.h"
-#include "jvmg/IR/ConstantPool/constantPoolInfo.h"
+#include "jvmg/util/mutf8.h"
 
 using namespace jvmg;
 
-std::string ParserContext::getConstantUTF8(int idx) const {
-    // Constant pool indices start at 1, so subtract 1
-    int constantIdx = idx - 1;
-    assert(constantIdx <= constantPool.size() - 1);
-
-    auto cpInfo = constantPool.at(constantIdx);
-    assert(cpInfo.tag == CPInfo::CONSTANT_Utf8);
-    ConstUTF8Info *utf8Info = cpInfo.asUTF8Info();
+namespace {
+    // Attributes are owned through raw pointers, and ~ClassFile frees those of the class and of its fields and
+    // methods. Until the class has been built, this frees whatever was parsed if the parse fails or throws.
+    class PartialClass {
+    public:
+        PartialClass(std::vector<ClassFile::FieldInfo> &fields, std::vector<ClassFile::MethodInfo> &methods,
+                     std::vector<AttributeInfo*> &attributes)
+            : fields(fields), methods(methods), attributes(attributes) {}
+
+        PartialClass(const PartialClass&) = delete;
+        PartialClass& operator=(const PartialClass&) = delete;
+
+        ~PartialClass() {
+            if (released) {
+                return;
+            }
+            for (auto &field : fields) {
+                deleteAll(field.attributes);
+            }
+            for (auto &method : methods) {
+                deleteAll(method.attributes);
+            }
+            deleteAll(attributes);
+        }
 
-    std::stringstream s;
+        void release() { released = true; }
 
-    for (int i = 0; i < utf8Info->getLength(); i++) {
-        s << utf8Info->getByte(i);
-    }
+    private:
+        static void deleteAll(std::vector<AttributeInfo*> &list) {
+            for (auto *attribute : list) {
+                delete attribute;
+            }
+            list.clear();
+        }
 
-    return s.str();
+        std::vector<ClassFile::FieldInfo> &fields;
+        std::vector<ClassFile::MethodInfo> &methods;
+        std::vector<AttributeInfo*> &attributes;
+        bool released = false;
+    };
 }
 
-CPInfo ParserContext::getConstant(int idx) const {
-    return constantPool.at(idx - 1);
+ClassFile Parser::consumeClassFile() {
+    auto classFile = parseClassFile();
+    if (!classFile) {
+        throwParseError(classFile.error());
+    }
+    return std::move(*classFile);
 }
 
-ClassFile Parser::consumeClassFile() {
+std::expected<ClassFile, ParseError> Parser::parseClassFile() {
     consumeMagic();
 
     std::uint16_t minorVersion = consumeTwoBytes();
     std::uint16_t majorVersion = consumeTwoBytes();
 
-    std::uint16_t constantPoolCount = consumeTwoBytes();
-
-    std::vector<CPInfo> constantPool;
-
-    // Constant pool count is 1-indexed
-    for (int i = 1; i < constantPoolCount; i++) {
-        CPInfo cpInfo = consumeConstantPoolInfo();
-        constantPool.push_back(cpInfo);
-        context->addConstantToPool(cpInfo);
-    }
+    consumeConstantPool();
+    auto constantPool = context->getConstantPool();
+    std::uint16_t constantPoolCount = constantPool->getCount();
 
     std::uint16_t accessFlags = consumeTwoBytes();
     std::uint16_t thisClass = consumeTwoBytes();
@@ -48,168 +69,203 @@ ClassFile Parser::consumeClassFile() {
 
     std::uint16_t interfacesCount = consumeTwoBytes();
     std::vector<std::uint16_t> interfaces;
-    for (int i = 0; i < interfacesCount; i++) {
+    for (int i = 0; i < interfacesCount && !error; i++) {
         interfaces.push_back(consumeTwoBytes());
     }
 
-    std::uint16_t fieldsCount = consumeTwoBytes();
     std::vector<ClassFile::FieldInfo> fields;
-    for (int i = 0; i < fieldsCount; i++) {
+    std::vector<ClassFile::MethodInfo> methods;
+    std::vector<AttributeInfo*> attributes;
+    PartialClass partialClass(fields, methods, attributes);
+
+    std::uint16_t fieldsCount = consumeTwoBytes();
+    for (int i = 0; i < fieldsCount && !error; i++) {
         ClassFile::FieldInfo fieldInfo = consumeFieldInfo();
         fields.push_back(fieldInfo);
     }
 
     std::uint16_t methodsCount = consumeTwoBytes();
-    std::vector<ClassFile::MethodInfo> methods;
-    for (int i = 0; i < methodsCount; i++) {
-        ClassFile::MethodInfo methodInfo = consumeMethodInfo();
-        methods.push_back(methodInfo);
+    if (!consumeMethodsInParallel(methodsCount, methods)) {
+        for (int i = 0; i < methodsCount && !error; i++) {
+            ClassFile::MethodInfo methodInfo = consumeMethodInfo();
+            methods.push_back(methodInfo);
+        }
     }
 
     std::uint16_t attributesCount = consumeTwoBytes();
-    std::vector<AttributeInfo*> attributes;
     AttributeInfo *attributesInfo;
-    for (int i = 0; i < attributesCount; i++) {
+    for (int i = 0; i < attributesCount && !error; i++) {
         attributesInfo = consumeAttributesInfo();
-        attributes.push_back(attributesInfo);
+        if (attributesInfo != nullptr) {
+            attributes.push_back(attributesInfo);
+        }
+    }
+
+    if (error) {
+        return std::unexpected(*error);
+    }
+    attributesCount = attributes.size();
+    ClassFile classFile{minorVersion, majorVersion, constantPoolCount, constantPool, accessFlags, thisClass, superClass, interfacesCount, interfaces, fieldsCount, fields, methodsCount, methods, attributesCount, attributes};
+    partialClass.release();
+    return classFile;
+}
+
+void Parser::reset(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner) {
+    if (ownsReader) {
+        reader->reset(bytes, std::move(owner));
+    } else {
+        reader = new Reader(bytes, std::move(owner));
+        ownsReader = true;
     }
+    allocations.constantPools += context->reset();
+    error.reset();
+}
 
-    return {minorVersion, majorVersion, constantPoolCount, constantPool, accessFlags, thisClass, superClass, interfacesCount, interfaces, fieldsCount, fields, methodsCount, methods, attributesCount, attributes};
+void Parser::reset(Reader *newReader) {
+    if (ownsReader) {
+        delete reader;
+    }
+    reader = newReader;
+    ownsReader = false;
+    allocations.constantPools += context->reset();
+    error.reset();
 }
 
 void Parser::consumeMagic() {
-    assert(consumeOneByte() == 0xCA);
-    assert(consumeOneByte() == 0xFE);
-    assert(consumeOneByte() == 0xBA);
-    assert(consumeOneByte() == 0xBE);
+    if (consumeFourBytes() != CLASS_MAGIC) {
+        fail(ParseError::BAD_MAGIC);
+    }
 }
 
-CPInfo Parser::consumeConstantPoolInfo() {
-    std::uint8_t tag = consumeOneByte();
+void Parser::consumeConstantPool() {
+    std::uint16_t constantPoolCount = consumeTwoBytes();
 
-    switch(tag) {
-        case CPInfo::ConstantType::CONSTANT_Class: {
-            auto nameIndex = consumeTwoBytes();
-            return ConstClassInfo(nameIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_String: {
-            auto stringIndex = consumeTwoBytes();
-            return ConstStringInfo(stringIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_MethodType: {
-            auto descriptorIndex = consumeTwoBytes();
-            return ConstMethodTypeInfo(descriptorIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_MethodHandle: {
-            auto referenceKind = consumeOneByte();
-            auto referenceIndex = consumeTwoBytes();
-            return ConstMethodHandleInfo(referenceKind, referenceIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_Fieldref: {
-            auto classIndex = consumeTwoBytes();
-            auto nameAndTypeIndex = consumeTwoBytes();
-            return ConstFieldRefInfo(classIndex, nameAndTypeIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_Methodref: {
-            auto classIndex = consumeTwoBytes();
-            auto nameAndTypeIndex = consumeTwoBytes();
-            return ConstMethodRefInfo(classIndex, nameAndTypeIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_InterfaceMethodref: {
-            auto classIndex = consumeTwoBytes();
-            auto nameAndTypeIndex = consumeTwoBytes();
-            return ConstInterfaceMethodRefInfo(classIndex, nameAndTypeIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_NameAndType: {
-            auto nameIndex = consumeTwoBytes();
-            auto descriptorIndex = consumeTwoBytes();
-            return ConstNameAndType(nameIndex, descriptorIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_Integer: {
-            auto bytes = consumeFourBytes();
-            return ConstIntegerInfo(bytes);
-        }
-        case CPInfo::ConstantType::CONSTANT_Float: {
-            auto bytes = consumeFourBytes();
-            return ConstFloatInfo(bytes);
-        }
-        case CPInfo::ConstantType::CONSTANT_InvokeDynamic: {
-            auto bootstrapMethodAttrIndex = consumeTwoBytes();
-            auto nameAndTypeIndex = consumeTwoBytes();
-            return ConstInvokeDynamicInfo(bootstrapMethodAttrIndex, nameAndTypeIndex);
-        }
-        case CPInfo::ConstantType::CONSTANT_Utf8:
-        {
-            std::uint16_t length = consumeTwoBytes();
-            std::vector<std::uint8_t> bytes;
-            for (int i = 0; i < length; i++) {
-                bytes.push_back(consumeOneByte());
-            }
-            return ConstUTF8Info(length, bytes);
-        }
-        case CPInfo::ConstantType::CONSTANT_Long: {
-            auto highBytes = consumeFourBytes();
-            auto lowBytes = consumeFourBytes();
-            return ConstLongInfo(highBytes, lowBytes);
+    auto &constantPool = *context->getConstantPool();
+    auto capacity = constantPool.getCapacityBytes();
+    // Most entries are small references, so guess 8 payload bytes per entry
+    constantPool.reserve(constantPoolCount, constantPoolCount * 8);
+
+    // Constant pool count is 1-indexed, and Long and Double entries take two slots
+    while (constantPool.getCount() < constantPoolCount && !error) {
+        consumeConstantPoolInfo(constantPool, constantPoolCount);
+    }
+    allocations.constantPoolGrowths += constantPool.getCapacityBytes() > capacity;
+}
+
+void Parser::consumeConstantPoolInfo(ConstantPool &constantPool, std::uint16_t constantPoolCount) {
+    auto tag = static_cast<ConstantPool::ConstantType>(consumeOneByte());
+
+    if (tag == ConstantPool::CONSTANT_Utf8) {
+        std::uint16_t length = consumeTwoBytes();
+        auto bytes = consumeBytes(length);
+        if (error) {
+            return;
         }
-        case CPInfo::ConstantType::CONSTANT_Double: {
-            auto highBytes = consumeFourBytes();
-            auto lowBytes = consumeFourBytes();
-            return ConstDoubleInfo(highBytes, lowBytes);
+        std::string_view value(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+        if ((options & ParseOptions::VALIDATE_UTF8) && !mutf8::validate(value)) {
+            fail(ParseError::BAD_UTF8);
+            return;
         }
-        default:
-            throw std::invalid_argument("Constant pool info tag invalid.");
+        constantPool.addUTF8(value);
+        return;
     }
+
+    // Every other entry has a fixed size, so its payload is copied as is
+    auto size = ConstantPool::getPayloadSize(tag);
+    if (size == 0) {
+        fail(ParseError::BAD_CONSTANT_TAG);
+        return;
+    }
+    auto payload = consumeBytes(size);
+    if (error) {
+        return;
+    }
+    // A Long or Double as the last entry would take a slot past the declared count. Since that count is a u2,
+    // checking against it also keeps the pool from throwing for lack of room.
+    if (constantPool.getCount() + (ConstantPool::isWide(tag) ? 2 : 1) > constantPoolCount) {
+        fail(ParseError::BAD_CONSTANT_INDEX);
+        return;
+    }
+    constantPool.add(tag, payload);
 }
 
 AttributeInfo *Parser::consumeAttributesInfo() {
+    auto sourceStart = reader->getOffset();
     std::uint16_t attributeNameIndex = consumeTwoBytes();
     std::uint32_t attributeLength = consumeFourBytes();
     Attribute *info = nullptr;
-    std::string attributeName = context->getConstantUTF8(attributeNameIndex);
-    AttributeInfo::AttributeNameTag attributeNameTag = AttributeInfo::getAttributeNameTag(attributeName);
+    std::string_view attributeName = getConstantUTF8(attributeNameIndex);
+    if (error) {
+        return nullptr;
+    }
+    AttributeInfo::AttributeNameTag attributeNameTag = context->getAttributeNameTag(attributeNameIndex);
+    if (ParseOptions::skips(options, attributeNameTag)) {
+        if (!(options & ParseOptions::KEEP_RAW)) {
+            skipBytes(attributeLength);
+            return nullptr;
+        }
+        attributeNameTag = AttributeInfo::UNKNOWN;
+    }
 
     auto *attributeInfo = new AttributeInfo(attributeNameIndex, attributeLength, info);
-    attributeInfo->setAttributeName(attributeName);
+    attributeInfo->setAttributeName(std::string(attributeName));
+    auto startOffset = context->getByteOffset();
 
     switch(attributeNameTag) {
         case AttributeInfo::CODE: {
             std::uint16_t maxStack = consumeTwoBytes();
             std::uint16_t maxLocals = consumeTwoBytes();
 
-            std::uint32_t codeLength = consumeFourBytes();
-            std::vector<Instruction> code;
-
-            // Code length is in bytes, and instructions are variable-length
-            // Keep track of bytes consumed
-            context->setCodeStartOffset(context->getByteOffset());
-            for (size_t i = 0; i < codeLength;) {
-                code.push_back((consumeInstruction()));
-                i += code.back().getSizeInBytes();
-            }
-
-            std::uint16_t exceptionTableLength = consumeTwoBytes();
-            std::vector<CodeAttribute::ExceptionTableEntry> exceptionTable;
-            for (int i = 0; i < exceptionTableLength; i++) {
-                std::uint16_t startPC = consumeTwoBytes();
-                std::uint16_t endPC = consumeTwoBytes();
-                std::uint16_t handlerPC = consumeTwoBytes();
-                std::uint16_t catchType = consumeTwoBytes();
-                exceptionTable.push_back({startPC, endPC, handlerPC, catchType});
+            std::uint32_t codeLength = consumeCodeLength();
+
+            if (options & ParseOptions::LAZY_CODE) {
+                // max_stack, max_locals and code_length take 8 of the attribute's bytes
+                if (!error && attributeLength < 8) {
+                    fail(ParseError::BAD_LENGTH);
+                    break;
+                }
+                auto body = consumeBytes(attributeLength - 8);
+                if (error) {
+                    break;
+                }
+                // Stream reads do not outlive the next read, so only they are copied
+                std::shared_ptr<const void> bodyOwner = reader->getOwner();
+                if (reader->getBackend() == Reader::STREAM) {
+                    auto copy = std::make_shared<const std::vector<std::uint8_t>>(body.begin(), body.end());
+                    body = *copy;
+                    bodyOwner = std::move(copy);
+                }
+                info = new CodeAttribute(maxStack, maxLocals, codeLength, body, std::move(bodyOwner),
+                                         [constantPool = std::shared_ptr<const ConstantPool>(context->getConstantPool()),
+                                          options = options | ParseOptions::KEEP_RAW](
+                                                 CodeAttribute &codeAttribute, std::span<const std::uint8_t> codeBody,
+                                                 const std::shared_ptr<const void> &codeBodyOwner) {
+                    // Nested attributes only need their names from the constant pool. The attribute length was
+                    // fixed when the body was read, so nothing may be dropped now.
+                    Parser parser(codeBody, codeBodyOwner, new ParserContext(constantPool));
+                    parser.options = options;
+                    parser.consumeCode(&codeAttribute);
+                    if (parser.error) {
+                        throwParseError(*parser.error);
+                    }
+                });
+                break;
             }
 
-            std::uint16_t attributesCount = consumeTwoBytes();
-            std::vector<AttributeInfo*> attributes;
-            for (int i = 0; i < attributesCount; i++) {
-                attributes.push_back(consumeAttributesInfo());
+            auto codeAttribute = new CodeAttribute(maxStack, maxLocals, codeLength, {}, 0, {}, 0, {});
+            auto droppedBytes = consumeCode(codeAttribute);
+            attributeInfo->attributeLength -= droppedBytes;
+            info = codeAttribute;
+            if (droppedBytes > 0) {
+                // The input no longer matches what is left
+                sourceStart = reader->getOffset();
             }
-            info = new CodeAttribute(maxStack, maxLocals, codeLength, code, exceptionTableLength, exceptionTable, attributesCount, attributes);
             break;
         }
         case AttributeInfo::LINE_NUMBER_TABLE: {
             std::uint16_t lineNumberTableLength = consumeTwoBytes();
             std::vector<LineNumberAttribute::LineNumberTableEntry> lineNumberTable;
-            for (int i = 0; i < lineNumberTableLength; i++) {
+            for (int i = 0; i < lineNumberTableLength && !error; i++) {
                 std::uint16_t startPC = consumeTwoBytes();
                 std::uint16_t lineNumber = consumeTwoBytes();
                 lineNumberTable.push_back({startPC, lineNumber});
@@ -219,67 +275,202 @@ AttributeInfo *Parser::consumeAttributesInfo() {
         }
         case AttributeInfo::SOURCE_FILE: {
             std::uint16_t sourceFileIndex = consumeTwoBytes();
-            info = new SourceFileAttribute(sourceFileIndex, attributeName);
+            info = new SourceFileAttribute(sourceFileIndex, std::string(attributeName));
+            break;
+        }
+        default: {
+            // Everything else is kept undecoded. Stream reads do not outlive the next read, so only they are copied.
+            auto bytes = consumeBytes(attributeLength);
+            if (error) {
+                break;
+            }
+            if (reader->getBackend() == Reader::STREAM) {
+                auto copy = std::make_shared<const std::vector<std::uint8_t>>(bytes.begin(), bytes.end());
+                info = new RawAttribute(*copy, copy);
+            } else {
+                info = new RawAttribute(bytes, reader->getOwner());
+            }
             break;
         }
-        default:
-            std::cout << "AttributeNameTag: " << attributeNameTag << std::endl;
-            throw std::invalid_argument("Invalid argument: " + attributeName);
+    }
+
+    // Decoded attributes must fill attribute_length exactly, as the JVM requires, so that stepping over an attribute
+    // by its length and decoding it end at the same place
+    if (!error && context->getByteOffset() - startOffset != attributeLength) {
+        fail(ParseError::BAD_LENGTH);
     }
 
     attributeInfo->info = info;
+    recordSource(*attributeInfo, sourceStart);
     return attributeInfo;
 }
 
+void Parser::recordSource(SourceBacked &node, std::size_t start) {
+    if (!(options & ParseOptions::COPY_UNCHANGED) || error) {
+        return;
+    }
+    auto buffer = reader->getBuffer();
+    auto end = reader->getOffset();
+    if (!buffer.empty() && start < end) {
+        node.setSource(buffer.subspan(start, end - start), reader->getOwner(), context->getConstantPool());
+    }
+}
+
+std::uint32_t Parser::consumeCode(CodeAttribute *codeAttribute) {
+    // Code length is in bytes, and instructions are variable-length
+    // Keep track of bytes consumed
+    context->setCodeStartOffset(context->getByteOffset());
+    auto &code = codeAttribute->code;
+    // Instructions average around two bytes
+    code.reserve(codeAttribute->codeLength / 2, codeAttribute->codeLength);
+    while (code.getCodeLength() < codeAttribute->codeLength && !error) {
+        consumeInstruction(code);
+    }
+
+    codeAttribute->exceptionTableLength = consumeTwoBytes();
+    for (int i = 0; i < codeAttribute->exceptionTableLength && !error; i++) {
+        std::uint16_t startPC = consumeTwoBytes();
+        std::uint16_t endPC = consumeTwoBytes();
+        std::uint16_t handlerPC = consumeTwoBytes();
+        std::uint16_t catchType = consumeTwoBytes();
+        codeAttribute->exceptionTable.push_back({startPC, endPC, handlerPC, catchType});
+    }
+
+    std::uint16_t attributesCount = consumeTwoBytes();
+    std::uint32_t droppedBytes = 0;
+    for (int i = 0; i < attributesCount && !error; i++) {
+        auto startOffset = context->getByteOffset();
+        auto *attributeInfo = consumeAttributesInfo();
+        if (attributeInfo != nullptr) {
+            codeAttribute->attributes.push_back(attributeInfo);
+        } else {
+            droppedBytes += context->getByteOffset() - startOffset;
+        }
+    }
+    codeAttribute->attributesCount = codeAttribute->attributes.size();
+    return droppedBytes;
+}
+
 ClassFile::FieldInfo Parser::consumeFieldInfo() {
+    auto sourceStart = reader->getOffset();
     std::uint16_t accessFlags = consumeTwoBytes();
     std::uint16_t nameIndex = consumeTwoBytes();
     std::uint16_t descriptorIndex = consumeTwoBytes();
     std::uint16_t attributesCount = consumeTwoBytes();
 
     std::vector<AttributeInfo*> attributes;
-    for (int i = 0; i < attributesCount; i++) {
-        attributes.push_back(consumeAttributesInfo());
+    for (int i = 0; i < attributesCount && !error; i++) {
+        if (auto *attributeInfo = consumeAttributesInfo()) {
+            attributes.push_back(attributeInfo);
+        }
     }
 
-    return {accessFlags, nameIndex, descriptorIndex, attributesCount, attributes};
+    ClassFile::FieldInfo member(accessFlags, nameIndex, descriptorIndex, static_cast<std::uint16_t>(attributes.size()), attributes);
+    // A dropped attribute, here or nested in one, leaves the input out of date for the member
+    if (attributesUnchanged(attributesCount, member.attributes)) {
+        recordSource(member, sourceStart);
+    }
+    return member;
 }
 
 ClassFile::MethodInfo Parser::consumeMethodInfo() {
+    auto sourceStart = reader->getOffset();
     std::uint16_t accessFlags = consumeTwoBytes();
     std::uint16_t nameIndex = consumeTwoBytes();
     std::uint16_t descriptorIndex = consumeTwoBytes();
     std::uint16_t attributesCount = consumeTwoBytes();
     std::vector<AttributeInfo*> attributes;
+    for (int i = 0; i < attributesCount && !error; i++) {
+        if (auto *attributeInfo = consumeAttributesInfo()) {
+            attributes.push_back(attributeInfo);
+        }
+    }
 
-    for (int i = 0; i < attributesCount; i++) {
-        attributes.push_back(consumeAttributesInfo());
+    ClassFile::MethodInfo member(accessFlags, nameIndex, descriptorIndex, static_cast<std::uint16_t>(attributes.size()), attributes);
+    // A dropped attribute, here or nested in one, leaves the input out of date for the member
+    if (attributesUnchanged(attributesCount, member.attributes)) {
+        recordSource(member, sourceStart);
     }
+    return member;
+}
 
-    return {accessFlags, nameIndex, descriptorIndex, attributesCount, attributes};
+void Parser::fail(ParseError::Reason reason) {
+    if (!error) {
+        error = ParseError{reason, static_cast<std::size_t>(context->getByteOffset())};
+    }
+}
+
+bool Parser::canConsume(std::size_t count) {
+    if (error) [[unlikely]] {
+        return false;
+    }
+    if (!reader->ensure(count)) [[unlikely]] {
+        fail(ParseError::TRUNCATED);
+        return false;
+    }
+    return true;
+}
+
+std::string_view Parser::getConstantUTF8(std::uint16_t index) {
+    const auto &constantPool = *context->getConstantPool();
+    if (index >= constantPool.getCount() || constantPool.getTag(index) != ConstantPool::CONSTANT_Utf8) [[unlikely]] {
+        fail(ParseError::BAD_CONSTANT_INDEX);
+        return {};
+    }
+    return constantPool.utf8(index);
+}
+
+std::string_view Parser::consumeUTF8Index() {
+    std::uint16_t index = consumeTwoBytes();
+    return error ? std::string_view() : getConstantUTF8(index);
+}
+
+std::uint32_t Parser::consumeCodeLength() {
+    std::uint32_t codeLength = consumeFourBytes();
+    // Code arrays hold at least one and at most 65535 bytes
+    if (codeLength == 0 || codeLength > 0xFFFF) {
+        fail(ParseError::BAD_LENGTH);
+        return 0;
+    }
+    return codeLength;
 }
 
 std::uint8_t Parser::consumeOneByte() {
+    if (!canConsume(1)) {
+        return 0;
+    }
     context->incrementByteOffset();
     return reader->readByte();
 }
 
 std::uint16_t Parser::consumeTwoBytes() {
-    std::uint8_t hbyte = reader->readByte();
-    context->incrementByteOffset();
-    std::uint8_t lbyte = reader->readByte();
-    context->incrementByteOffset();
-    return (hbyte << 8) | lbyte;
+    if (!canConsume(2)) {
+        return 0;
+    }
+    context->incrementByteOffset(2);
+    return reader->readTwoBytes();
 }
 
 std::uint32_t Parser::consumeFourBytes() {
-    std::uint8_t hhbyte = reader->readByte();
-    context->incrementByteOffset();
-    std::uint8_t hlbyte = reader->readByte();
-    context->incrementByteOffset();
-    std::uint8_t lhbyte = reader->readByte();
-    context->incrementByteOffset();
-    std::uint8_t llbyte = reader->readByte();
-    context->incrementByteOffset();
-    return (hhbyte << 24) | (hlbyte << 16) | ( lhbyte << 8) | llbyte;
-}
\ No newline at end of file
+    if (!canConsume(4)) {
+        return 0;
+    }
+    context->incrementByteOffset(4);
+    return reader->readFourBytes();
+}
+
+std::span<const std::uint8_t> Parser::consumeBytes(std::size_t count) {
+    if (!canConsume(count)) {
+        return {};
+    }
+    context->incrementByteOffset(count);
+    return reader->readBytes(count);
+}
+
+void Parser::skipBytes(std::size_t count) {
+    if (!canConsume(count)) {
+        return;
+    }
+    context->incrementByteOffset(count);
+    reader->skipBytes(count);
+}
@@ -0,0 +1,276 @@
+//
+// Created by Micky on 2/7/2024.
+//
+
+#include "jvmg/parser/pipeline.h"
+#include "jvmg/archive/jarReader.h"
+#include "jvmg/util/boundedQueue.h"
+
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <utility>
+
+using namespace jvmg;
+
+namespace {
+    struct Item {
+        // A loose class file, or an entry of jar when one is given
+        explicit Item(std::string name, std::shared_ptr<JarReader> jar = nullptr, const JarReader::Entry *entry = nullptr)
+            : name(std::move(name)), jar(std::move(jar)), entry(entry) {}
+
+        std::string name;
+        std::shared_ptr<JarReader> jar;
+        const JarReader::Entry *entry = nullptr;
+        std::vector<std::uint8_t> buffer;
+        std::span<const std::uint8_t> bytes;
+        std::size_t charge = 0;
+        std::optional<ClassFile> classFile;
+    };
+
+    using ItemQueue = BoundedQueue<Item *>;
+
+    class ByteBudget {
+    public:
+        explicit ByteBudget(std::size_t limit) : limit(limit) {}
+
+        std::chrono::nanoseconds acquire(std::size_t bytes) {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto start = std::chrono::steady_clock::now();
+            released.wait(lock, [&] { return used == 0 || used + bytes <= limit; });
+            used += bytes;
+            peak = std::max(peak, used);
+            return std::chrono::steady_clock::now() - start;
+        }
+
+        void release(std::size_t bytes) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                used -= bytes;
+            }
+            released.notify_all();
+        }
+
+        [[nodiscard]] std::size_t getPeak() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return peak;
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable released;
+        const std::size_t limit;
+        std::size_t used = 0;
+        std::size_t peak = 0;
+    };
+
+    struct StageCounters {
+        std::atomic<std::uint64_t> items = 0;
+        std::atomic<std::uint64_t> bytes = 0;
+        std::atomic<std::int64_t> busyNanos = 0;
+        std::atomic<std::int64_t> blockedNanos = 0;
+
+        void addBlocked(std::chrono::nanoseconds time) { blockedNanos += time.count(); }
+
+        void add(std::uint64_t size) {
+            items++;
+            bytes += size;
+        }
+
+        // Runs work and records it as one item of the given size
+        template<typename F>
+        void measure(std::uint64_t size, F work) {
+            auto start = std::chrono::steady_clock::now();
+            work();
+            busyNanos += (std::chrono::steady_clock::now() - start).count();
+            add(size);
+        }
+
+        [[nodiscard]] StageStats snapshot() const {
+            return {items, bytes, std::chrono::nanoseconds(busyNanos), std::chrono::nanoseconds(blockedNanos)};
+        }
+    };
+
+    class ErrorSlot {
+    public:
+        void record() { record(std::current_exception()); }
+
+        void record(std::exception_ptr error) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!first) {
+                first = std::move(error);
+            }
+        }
+
+        void rethrow() {
+            if (first) {
+                std::rethrow_exception(first);
+            }
+        }
+
+    private:
+        std::mutex mutex;
+        std::exception_ptr first;
+    };
+
+    // Starts threadCount workers running body; the last one to finish closes the downstream queue
+    void startStage(std::vector<std::thread> &threads, unsigned threadCount, ItemQueue &downstream,
+                    const std::function<void()> &body) {
+        threadCount = std::max(threadCount, 1u);
+        auto remaining = std::make_shared<std::atomic<unsigned>>(threadCount);
+        for (unsigned i = 0; i < threadCount; i++) {
+            threads.emplace_back([&downstream, body, remaining] {
+                body();
+                if (--*remaining == 0) {
+                    downstream.close();
+                }
+            });
+        }
+    }
+}
+
+PipelineStats Pipeline::run(const std::vector<std::string> &inputs, const Consumer &consumer) {
+    auto start = std::chrono::steady_clock::now();
+
+    ItemQueue toInflate(options.queueCapacity);
+    ItemQueue toParse(options.queueCapacity);
+    ItemQueue toConsume(options.queueCapacity);
+    ByteBudget budget(options.memoryBudget);
+    StageCounters readCounters, inflateCounters, parseCounters, consumeCounters;
+    ErrorSlot errors;
+    std::atomic<std::size_t> nextInput = 0;
+
+    auto drop = [&](Item *item) {
+        budget.release(item->charge);
+        delete item;
+    };
+
+    std::vector<std::thread> threads;
+
+    startStage(threads, options.readThreads, toInflate, [&] {
+        for (auto index = nextInput++; index < inputs.size(); index = nextInput++) {
+            const auto &input = inputs[index];
+            try {
+                if (input.ends_with(".jar")) {
+                    auto jar = std::make_shared<JarReader>(input);
+                    for (const auto &entry : jar->getEntries()) {
+                        if (!entry.isClass()) {
+                            continue;
+                        }
+                        readCounters.addBlocked(budget.acquire(entry.uncompressedSize));
+                        auto item = new Item(entry.name, jar, &entry);
+                        item->charge = entry.uncompressedSize;
+                        readCounters.add(entry.compressedSize);
+                        readCounters.addBlocked(toInflate.push(item));
+                    }
+                } else {
+                    auto size = std::filesystem::file_size(input);
+                    readCounters.addBlocked(budget.acquire(size));
+                    auto item = new Item(input);
+                    item->charge = size;
+                    try {
+                        readCounters.measure(size, [&] {
+                            std::ifstream file(input, std::ios::binary);
+                            item->buffer.resize(size);
+                            if (!file.read(reinterpret_cast<char *>(item->buffer.data()), static_cast<std::streamsize>(size))) {
+                                throw std::runtime_error("Failed to read " + input);
+                            }
+                            item->bytes = item->buffer;
+                        });
+                    } catch (...) {
+                        drop(item);
+                        throw;
+                    }
+                    readCounters.addBlocked(toInflate.push(item));
+                }
+            } catch (...) {
+                errors.record();
+            }
+        }
+    });
+
+    startStage(threads, options.inflateThreads, toParse, [&] {
+        Item *item;
+        while (toInflate.pop(item)) {
+            try {
+                if (item->entry != nullptr) {
+                    inflateCounters.measure(item->entry->uncompressedSize, [&] {
+                        item->bytes = item->jar->readEntry(*item->entry, item->buffer);
+                    });
+                }
+                inflateCounters.addBlocked(toParse.push(item));
+            } catch (...) {
+                errors.record();
+                drop(item);
+            }
+        }
+    });
+
+    startStage(threads, options.parseThreads, toConsume, [&] {
+        Item *item;
+        while (toParse.pop(item)) {
+            try {
+                std::optional<ParseError> error;
+                parseCounters.measure(item->bytes.size(), [&] {
+                    // Attributes kept undecoded point into the input, so the class shares ownership of it
+                    auto input = std::make_shared<std::pair<std::shared_ptr<JarReader>, std::vector<std::uint8_t>>>(
+                            item->jar, std::move(item->buffer));
+                    Parser parser(item->bytes, input);
+                    parser.setOptions(options.parseOptions);
+                    auto classFile = parser.parseClassFile();
+                    if (classFile) {
+                        item->classFile.emplace(std::move(*classFile));
+                    } else {
+                        error = classFile.error();
+                    }
+                });
+                // Malformed classes are common in large corpora, so they are reported without unwinding
+                if (error) {
+                    errors.record(makeParseException(*error));
+                    drop(item);
+                    continue;
+                }
+                // The parsed class holds its own reference to the input, if it needs one
+                item->buffer = {};
+                item->bytes = {};
+                parseCounters.addBlocked(toConsume.push(item));
+            } catch (...) {
+                errors.record();
+                drop(item);
+            }
+        }
+    });
+
+    // The consume stage has no downstream queue, so it closes a placeholder
+    ItemQueue finished(1);
+    startStage(threads, options.consumeThreads, finished, [&] {
+        Item *item;
+        while (toConsume.pop(item)) {
+            try {
+                consumeCounters.measure(item->charge, [&] {
+                    consumer(item->name, std::move(*item->classFile));
+                });
+            } catch (...) {
+                errors.record();
+            }
+            drop(item);
+        }
+    });
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    PipelineStats stats;
+    stats.read = readCounters.snapshot();
+    stats.inflate = inflateCounters.snapshot();
+    stats.parse = parseCounters.snapshot();
+    stats.consume = consumeCounters.snapshot();
+    stats.wallTime = std::chrono::steady_clock::now() - start;
+    stats.peakBytesInFlight = budget.getPeak();
+
+    errors.rethrow();
+    return stats;
+}
@@ -0,0 +1,242 @@
+//
+// Created by Micky on 2/12/2024.
+//
+
+#include "jvmg/parser/parser.h"
+
+using namespace jvmg;
+
+void Parser::consumeClassFile(ClassVisitor &visitor) {
+    auto result = parseClassFile(visitor);
+    if (!result) {
+        throwParseError(result.error());
+    }
+}
+
+ClassHeader Parser::consumeClassHeader() {
+    auto header = parseClassHeader();
+    if (!header) {
+        throwParseError(header.error());
+    }
+    return std::move(*header);
+}
+
+std::expected<void, ParseError> Parser::parseClassFile(ClassVisitor &visitor) {
+    consumeMagic();
+
+    std::uint16_t minorVersion = consumeTwoBytes();
+    std::uint16_t majorVersion = consumeTwoBytes();
+    consumeConstantPool();
+
+    std::uint16_t accessFlags = consumeTwoBytes();
+    std::uint16_t thisClass = consumeTwoBytes();
+    std::uint16_t superClass = consumeTwoBytes();
+    if (error) {
+        return std::unexpected(*error);
+    }
+    visitor.visit(minorVersion, majorVersion, *context->getConstantPool(), accessFlags, thisClass, superClass);
+
+    std::uint16_t interfacesCount = consumeTwoBytes();
+    for (int i = 0; i < interfacesCount; i++) {
+        std::uint16_t interfaceIndex = consumeTwoBytes();
+        if (error) {
+            return std::unexpected(*error);
+        }
+        visitor.visitInterface(interfaceIndex);
+    }
+
+    std::uint16_t fieldsCount = consumeTwoBytes();
+    for (int i = 0; i < fieldsCount; i++) {
+        std::uint16_t fieldAccessFlags = consumeTwoBytes();
+        std::string_view name = consumeUTF8Index();
+        std::string_view descriptor = consumeUTF8Index();
+        if (error) {
+            return std::unexpected(*error);
+        }
+        FieldVisitor *fieldVisitor = visitor.visitField(fieldAccessFlags, name, descriptor);
+
+        std::uint16_t attributesCount = consumeTwoBytes();
+        for (int j = 0; j < attributesCount; j++) {
+            auto [attributeName, attributeLength, attributeNameTag] = consumeAttributeHeader();
+            if (fieldVisitor == nullptr || ParseOptions::drops(options, attributeNameTag)) {
+                skipBytes(attributeLength);
+                continue;
+            }
+            auto info = consumeBytes(attributeLength);
+            if (error) {
+                return std::unexpected(*error);
+            }
+            fieldVisitor->visitAttribute(attributeName, info);
+        }
+        if (error) {
+            return std::unexpected(*error);
+        }
+        if (fieldVisitor != nullptr) {
+            fieldVisitor->visitEnd();
+        }
+    }
+
+    std::uint16_t methodsCount = consumeTwoBytes();
+    for (int i = 0; i < methodsCount; i++) {
+        std::uint16_t methodAccessFlags = consumeTwoBytes();
+        std::string_view name = consumeUTF8Index();
+        std::string_view descriptor = consumeUTF8Index();
+        if (error) {
+            return std::unexpected(*error);
+        }
+        MethodVisitor *methodVisitor = visitor.visitMethod(methodAccessFlags, name, descriptor);
+
+        std::uint16_t attributesCount = consumeTwoBytes();
+        for (int j = 0; j < attributesCount; j++) {
+            auto [attributeName, attributeLength, attributeNameTag] = consumeAttributeHeader();
+            if (methodVisitor == nullptr || ParseOptions::drops(options, attributeNameTag)) {
+                skipBytes(attributeLength);
+            } else if (attributeNameTag == AttributeInfo::CODE && !ParseOptions::skips(options, attributeNameTag)) {
+                visitCode(*methodVisitor, attributeLength);
+            } else {
+                auto info = consumeBytes(attributeLength);
+                if (!error) {
+                    methodVisitor->visitAttribute(attributeName, info);
+                }
+            }
+            if (error) {
+                return std::unexpected(*error);
+            }
+        }
+        if (methodVisitor != nullptr) {
+            methodVisitor->visitEnd();
+        }
+    }
+
+    std::uint16_t attributesCount = consumeTwoBytes();
+    for (int i = 0; i < attributesCount; i++) {
+        auto [attributeName, attributeLength, attributeNameTag] = consumeAttributeHeader();
+        if (ParseOptions::drops(options, attributeNameTag)) {
+            skipBytes(attributeLength);
+            continue;
+        }
+        auto info = consumeBytes(attributeLength);
+        if (error) {
+            return std::unexpected(*error);
+        }
+        visitor.visitAttribute(attributeName, info);
+    }
+    if (error) {
+        return std::unexpected(*error);
+    }
+
+    visitor.visitEnd();
+    return {};
+}
+
+std::expected<ClassHeader, ParseError> Parser::parseClassHeader() {
+    consumeMagic();
+
+    ClassHeader header;
+    header.minorVersion = consumeTwoBytes();
+    header.majorVersion = consumeTwoBytes();
+    consumeConstantPool();
+    header.constantPool = context->getConstantPool();
+
+    header.accessFlags = consumeTwoBytes();
+    header.thisClass = consumeTwoBytes();
+    header.superClass = consumeTwoBytes();
+
+    std::uint16_t interfacesCount = consumeTwoBytes();
+    header.interfaces.reserve(interfacesCount);
+    for (int i = 0; i < interfacesCount && !error; i++) {
+        header.interfaces.push_back(consumeTwoBytes());
+    }
+
+    // Members are stepped over using attribute_length; the class's own attributes are never read
+    for (auto *members : {&header.fields, &header.methods}) {
+        std::uint16_t membersCount = consumeTwoBytes();
+        members->reserve(membersCount);
+        for (int i = 0; i < membersCount && !error; i++) {
+            std::uint16_t accessFlags = consumeTwoBytes();
+            std::uint16_t nameIndex = consumeTwoBytes();
+            std::uint16_t descriptorIndex = consumeTwoBytes();
+            members->push_back({accessFlags, nameIndex, descriptorIndex});
+
+            std::uint16_t attributesCount = consumeTwoBytes();
+            for (int j = 0; j < attributesCount && !error; j++) {
+                consumeTwoBytes();
+                skipBytes(consumeFourBytes());
+            }
+        }
+    }
+
+    if (error) {
+        return std::unexpected(*error);
+    }
+    return header;
+}
+
+Parser::AttributeHeader Parser::consumeAttributeHeader() {
+    std::uint16_t attributeNameIndex = consumeTwoBytes();
+    std::uint32_t attributeLength = consumeFourBytes();
+    std::string_view attributeName = getConstantUTF8(attributeNameIndex);
+    if (error) {
+        return {{}, 0, AttributeInfo::UNKNOWN};
+    }
+    return {attributeName, attributeLength, context->getAttributeNameTag(attributeNameIndex)};
+}
+
+void Parser::visitCode(MethodVisitor &visitor, std::uint32_t attributeLength) {
+    auto startOffset = context->getByteOffset();
+    std::uint16_t maxStack = consumeTwoBytes();
+    std::uint16_t maxLocals = consumeTwoBytes();
+    std::uint32_t codeLength = consumeCodeLength();
+
+    if (error) {
+        return;
+    }
+    if (!visitor.visitCode(maxStack, maxLocals, codeLength)) {
+        // max_stack, max_locals and code_length take 8 of the attribute's bytes
+        skipBytes(attributeLength - 8);
+        return;
+    }
+
+    // The code array is walked in place; nothing is read until the last instruction has been visited
+    auto code = consumeBytes(codeLength);
+    for (std::uint32_t bci = 0; bci < codeLength && !error;) {
+        auto instruction = InstructionView::decode(code, bci);
+        if (!instruction) {
+            fail(ParseError::BAD_INSTRUCTION);
+            return;
+        }
+        visitor.visitInstruction(*instruction);
+        bci += instruction->getSizeInBytes();
+    }
+
+    std::uint16_t exceptionTableLength = consumeTwoBytes();
+    for (int i = 0; i < exceptionTableLength; i++) {
+        std::uint16_t startPC = consumeTwoBytes();
+        std::uint16_t endPC = consumeTwoBytes();
+        std::uint16_t handlerPC = consumeTwoBytes();
+        std::uint16_t catchType = consumeTwoBytes();
+        if (error) {
+            return;
+        }
+        visitor.visitExceptionHandler(startPC, endPC, handlerPC, catchType);
+    }
+
+    std::uint16_t attributesCount = consumeTwoBytes();
+    for (int i = 0; i < attributesCount; i++) {
+        auto [attributeName, nestedLength, nestedNameTag] = consumeAttributeHeader();
+        if (ParseOptions::drops(options, nestedNameTag)) {
+            skipBytes(nestedLength);
+            continue;
+        }
+        auto info = consumeBytes(nestedLength);
+        if (error) {
+            return;
+        }
+        visitor.visitCodeAttribute(attributeName, info);
+    }
+
+    // As in consumeAttributesInfo, so that both parsers reject the same inputs
+    if (!error && context->getByteOffset() - startOffset != attributeLength) {
+        fail(ParseError::BAD_LENGTH);
+    }
+}
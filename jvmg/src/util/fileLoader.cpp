@@ -0,0 +1,429 @@
+//
+// Created by Micky on 2/6/2024.
+//
+
+#include "jvmg/util/fileLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define JVMG_HAS_IO_URING 1
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace jvmg;
+
+#ifdef JVMG_HAS_IO_URING
+
+// Minimal io_uring wrapper over the raw syscalls: one submission ring, one completion ring
+struct FileLoader::Ring {
+    int fd = -1;
+    void *sqRing = MAP_FAILED;
+    void *cqRing = MAP_FAILED;
+    std::size_t sqRingSize = 0;
+    std::size_t cqRingSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    std::size_t sqesSize = 0;
+
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    unsigned pendingSubmit = 0;
+    // Queued or submitted, and not yet reaped
+    std::size_t inFlight = 0;
+
+    bool init(unsigned entries) {
+        io_uring_params params{};
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        if (singleMmap) {
+            cqRing = sqRing;
+        } else {
+            cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                return false;
+            }
+        }
+
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(
+                mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        auto sq = static_cast<char *>(sqRing);
+        sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+
+        auto cq = static_cast<char *>(cqRing);
+        cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        // Kernels before 5.6 create the ring but fail every one of these with EINVAL
+        return supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE});
+    }
+
+    // False if the kernel cannot say, which is the case wherever the operations above are missing
+    bool supports(std::initializer_list<std::uint8_t> opcodes) const {
+        constexpr unsigned PROBE_OPS = 256;
+        std::vector<std::uint8_t> buffer(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+        auto *probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+            return false;
+        }
+        for (auto opcode : opcodes) {
+            if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    // Callers never queue more entries than the ring holds before calling submitAndWait()
+    io_uring_sqe *nextSqe(std::uint8_t opcode, std::uint64_t userData) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe *sqe = &sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->user_data = userData;
+        sqArray[index] = index;
+        std::atomic_ref<unsigned>(*sqTail).store(tail + 1, std::memory_order_release);
+        pendingSubmit++;
+        inFlight++;
+        return sqe;
+    }
+
+    // Submits everything queued and blocks until at least one completion is available
+    void submitAndWait() {
+        while (true) {
+            long ret = syscall(__NR_io_uring_enter, fd, pendingSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret >= 0) {
+                pendingSubmit -= std::min<unsigned>(pendingSubmit, static_cast<unsigned>(ret));
+                if (pendingSubmit == 0) {
+                    return;
+                }
+            } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+            }
+        }
+    }
+
+    template<typename F>
+    unsigned reap(F onCompletion) {
+        unsigned head = *cqHead;
+        unsigned tail = std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire);
+        unsigned count = 0;
+        while (head != tail) {
+            const io_uring_cqe &cqe = cqes[head & *cqMask];
+            onCompletion(cqe.user_data, cqe.res);
+            head++;
+            count++;
+        }
+        std::atomic_ref<unsigned>(*cqHead).store(head, std::memory_order_release);
+        inFlight -= count;
+        return count;
+    }
+
+    // Submits whatever is queued and waits for every operation to complete. False if the ring stopped working
+    // first.
+    template<typename F>
+    bool drain(F onCompletion) {
+        while (inFlight > 0) {
+            long ret = syscall(__NR_io_uring_enter, fd, pendingSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret >= 0) {
+                pendingSubmit -= std::min<unsigned>(pendingSubmit, static_cast<unsigned>(ret));
+            } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return false;
+            }
+            reap(onCompletion);
+        }
+        return true;
+    }
+};
+
+#else
+
+struct FileLoader::Ring {
+    bool init(unsigned) { return false; }
+};
+
+#endif
+
+FileLoader::FileLoader(unsigned batchSize, unsigned threadCount) : FileLoader(IO_URING, batchSize, threadCount) {}
+
+FileLoader::FileLoader(Backend backend, unsigned batchSize, unsigned threadCount)
+    : backend(THREADED), batchSize(std::max(batchSize, 1u)), threadCount(threadCount) {
+    if (backend == IO_URING) {
+        // Every file in a batch has an open and a statx in flight at the same time
+        ring = new Ring();
+        if (ring->init(this->batchSize * 2)) {
+            this->backend = IO_URING;
+        } else {
+            delete ring;
+            ring = nullptr;
+        }
+    }
+}
+
+FileLoader::~FileLoader() {
+    delete ring;
+}
+
+bool FileLoader::isIoUringAvailable() {
+#ifdef JVMG_HAS_IO_URING
+    Ring probe;
+    return probe.init(1);
+#else
+    return false;
+#endif
+}
+
+void FileLoader::load(const std::vector<std::string> &filenames, const Callback &callback) {
+    if (backend == THREADED) {
+        loadThreaded(filenames, callback);
+        return;
+    }
+
+    std::exception_ptr firstError;
+    for (std::size_t begin = 0; begin < filenames.size(); begin += batchSize) {
+        loadBatch(filenames, begin, std::min<std::size_t>(begin + batchSize, filenames.size()), callback, firstError);
+    }
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+void FileLoader::loadBatch(const std::vector<std::string> &filenames, std::size_t begin, std::size_t end,
+                           const Callback &callback, std::exception_ptr &firstError) {
+#ifdef JVMG_HAS_IO_URING
+    struct Slot {
+        int fd = -1;
+        int error = 0;
+        struct statx stat {};
+        std::vector<std::uint8_t> bytes;
+        std::size_t filled = 0;
+    };
+
+    std::size_t count = end - begin;
+    std::vector<Slot> slots(count);
+
+    auto fail = [&](std::size_t i, int error) {
+        if (slots[i].error == 0) {
+            slots[i].error = error;
+            if (!firstError) {
+                firstError = std::make_exception_ptr(
+                        std::system_error(error, std::generic_category(), "Failed to read " + filenames[begin + i]));
+            }
+        }
+    };
+
+    auto deliver = [&](std::size_t i) {
+        try {
+            callback(begin + i, std::move(slots[i].bytes));
+        } catch (...) {
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+    };
+
+    // Submitted operations point into slots and filenames, so slots must not be freed while any is in flight
+    enum { OPENING, READING, CLOSING } phase = OPENING;
+    try {
+        // Open and size every file in the batch with one submission. user_data = slot * 2 + (0 open, 1 statx)
+        for (std::size_t i = 0; i < count; i++) {
+            const char *path = filenames[begin + i].c_str();
+
+            io_uring_sqe *open = ring->nextSqe(IORING_OP_OPENAT, i * 2);
+            open->fd = AT_FDCWD;
+            open->addr = reinterpret_cast<std::uint64_t>(path);
+            open->open_flags = O_RDONLY | O_CLOEXEC;
+
+            io_uring_sqe *stat = ring->nextSqe(IORING_OP_STATX, i * 2 + 1);
+            stat->fd = AT_FDCWD;
+            stat->addr = reinterpret_cast<std::uint64_t>(path);
+            stat->len = STATX_SIZE;
+            stat->off = reinterpret_cast<std::uint64_t>(&slots[i].stat);
+        }
+
+        std::size_t outstanding = count * 2;
+        while (outstanding > 0) {
+            ring->submitAndWait();
+            outstanding -= ring->reap([&](std::uint64_t userData, int res) {
+                std::size_t i = userData / 2;
+                if (res < 0) {
+                    fail(i, -res);
+                } else if (userData % 2 == 0) {
+                    slots[i].fd = res;
+                }
+            });
+        }
+
+        // Read each file whole; short reads are resubmitted for the remainder
+        auto queueRead = [&](std::size_t i) {
+            Slot &slot = slots[i];
+            io_uring_sqe *read = ring->nextSqe(IORING_OP_READ, i);
+            read->fd = slot.fd;
+            read->addr = reinterpret_cast<std::uint64_t>(slot.bytes.data() + slot.filled);
+            read->len = static_cast<std::uint32_t>(std::min<std::size_t>(slot.bytes.size() - slot.filled, 1u << 30));
+            read->off = slot.filled;
+        };
+
+        phase = READING;
+        outstanding = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            Slot &slot = slots[i];
+            if (slot.error != 0) {
+                continue;
+            }
+            slot.bytes.resize(slot.stat.stx_size);
+            if (slot.bytes.empty()) {
+                deliver(i);
+                continue;
+            }
+            queueRead(i);
+            outstanding++;
+        }
+
+        while (outstanding > 0) {
+            ring->submitAndWait();
+            ring->reap([&](std::uint64_t userData, int res) {
+                Slot &slot = slots[userData];
+                if (res < 0) {
+                    fail(userData, -res);
+                    outstanding--;
+                    return;
+                }
+                slot.filled += res;
+                if (res == 0) {
+                    // The file shrank after statx
+                    slot.bytes.resize(slot.filled);
+                }
+                if (slot.filled < slot.bytes.size()) {
+                    queueRead(userData);
+                    return;
+                }
+                outstanding--;
+                deliver(userData);
+            });
+        }
+
+        phase = CLOSING;
+        outstanding = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            if (slots[i].fd >= 0) {
+                ring->nextSqe(IORING_OP_CLOSE, i)->fd = slots[i].fd;
+                outstanding++;
+            }
+        }
+        while (outstanding > 0) {
+            ring->submitAndWait();
+            outstanding -= ring->reap([](std::uint64_t, int) {});
+        }
+    } catch (...) {
+        bool drained = ring->drain([&](std::uint64_t userData, int res) {
+            if (phase == OPENING && userData % 2 == 0 && res >= 0) {
+                slots[userData / 2].fd = res;
+            }
+        });
+        if (phase != CLOSING) {
+            for (auto &slot : slots) {
+                if (slot.fd >= 0) {
+                    close(slot.fd);
+                }
+            }
+        }
+        if (!drained) {
+            // Closing the ring cancels what is left, but the kernel may still be writing into slots while it
+            // does, so they are leaked rather than freed. Later batches read on threads.
+            delete ring;
+            ring = nullptr;
+            backend = THREADED;
+            (void) new std::vector<Slot>(std::move(slots));
+        }
+        throw;
+    }
+#endif
+}
+
+void FileLoader::loadThreaded(const std::vector<std::string> &filenames, const Callback &callback) {
+    if (!pool) {
+        pool = std::make_unique<ThreadPool>(threadCount);
+    }
+    for (std::size_t i = 0; i < filenames.size(); i++) {
+        pool->submit([&filenames, &callback, i] {
+            const auto &filename = filenames[i];
+            // Missing files and directories are told apart here, before anything is opened
+            std::error_code sizeError;
+            auto size = std::filesystem::file_size(filename, sizeError);
+            if (sizeError) {
+                throw std::system_error(sizeError, "Failed to read " + filename);
+            }
+
+            // The stream keeps no error of its own, so a failed open is reported from errno
+            errno = 0;
+            std::ifstream file(filename, std::ios::binary);
+            if (!file) {
+                throw std::system_error(errno != 0 ? errno : EIO, std::generic_category(), "Failed to read " + filename);
+            }
+
+            std::vector<std::uint8_t> bytes(size);
+            file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            bytes.resize(file.gcount());
+            callback(i, std::move(bytes));
+        });
+    }
+    pool->wait();
+}
@@ -0,0 +1,201 @@
+//
+// Created by Micky on 2/18/2024.
+//
+
+#include "jvmg/util/fileWriter.h"
+#include "jvmg/util/threadPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <unordered_set>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JVMG_HAS_POSIX_IO 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace jvmg;
+
+namespace {
+    // O_DIRECT wants the buffer, the length and the file offset aligned to the logical block size; a page
+    // covers every common device
+    constexpr std::size_t DIRECT_ALIGNMENT = 4096;
+
+    std::size_t alignUp(std::size_t size) {
+        return (size + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+    }
+
+    // Page-aligned and never shrunk, so a task serializes every class it writes into the same memory
+    class AlignedBuffer {
+    public:
+        AlignedBuffer() = default;
+        AlignedBuffer(const AlignedBuffer&) = delete;
+        AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+        ~AlignedBuffer() { release(); }
+
+        // size bytes, followed by padding up to the next alignment boundary
+        std::span<std::uint8_t> get(std::size_t size) {
+            if (alignUp(size) > capacity) {
+                auto newCapacity = alignUp(std::max(size, capacity * 2));
+                release();
+                // Aligned operator new is the portable choice; MSVC has no std::aligned_alloc
+                data = static_cast<std::uint8_t *>(::operator new(newCapacity, std::align_val_t{DIRECT_ALIGNMENT}));
+                capacity = newCapacity;
+            }
+            return {data, size};
+        }
+
+    private:
+        void release() {
+            if (data != nullptr) {
+                ::operator delete(data, std::align_val_t{DIRECT_ALIGNMENT});
+                data = nullptr;
+                capacity = 0;
+            }
+        }
+
+        std::uint8_t *data = nullptr;
+        std::size_t capacity = 0;
+    };
+
+    [[noreturn]] void throwWriteError(int error, const std::string &filename) {
+        throw std::system_error(error, std::generic_category(), "Failed to write " + filename);
+    }
+
+#ifdef JVMG_HAS_POSIX_IO
+    // Returns 0 or the errno of the failed write
+    int writeAll(int fd, const std::uint8_t *bytes, std::size_t count) {
+        off_t offset = 0;
+        while (count > 0) {
+            auto written = pwrite(fd, bytes, count, offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno;
+            }
+            bytes += written;
+            count -= written;
+            offset += written;
+        }
+        return 0;
+    }
+#endif
+
+    // With direct, bytes must come from an AlignedBuffer, whose padding is written and then truncated away
+    void writeWholeFile(const std::string &filename, std::span<const std::uint8_t> bytes, bool preallocate, bool direct) {
+#ifdef JVMG_HAS_POSIX_IO
+        int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        int fd = -1;
+#ifdef O_DIRECT
+        if (direct) {
+            fd = open(filename.c_str(), flags | O_DIRECT, 0644);
+        }
+#endif
+        bool isDirect = fd >= 0;
+        if (fd < 0) {
+            fd = open(filename.c_str(), flags, 0644);
+        }
+        if (fd < 0) {
+            throwWriteError(errno, filename);
+        }
+
+#ifdef __linux__
+        if (preallocate && !bytes.empty()) {
+            // Best effort: filesystems without support still take the write
+            (void) posix_fallocate(fd, 0, static_cast<off_t>(bytes.size()));
+        }
+#else
+        (void) preallocate;
+#endif
+
+        int error = 0;
+#ifdef O_DIRECT
+        if (isDirect) {
+            error = writeAll(fd, bytes.data(), alignUp(bytes.size()));
+            if (error == 0 && ftruncate(fd, static_cast<off_t>(bytes.size())) != 0) {
+                error = errno;
+            } else if (error == EINVAL) {
+                // The filesystem took the flag but not the I/O; write through the page cache instead
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+                error = writeAll(fd, bytes.data(), bytes.size());
+            }
+        } else {
+            error = writeAll(fd, bytes.data(), bytes.size());
+        }
+#else
+        (void) isDirect;
+        error = writeAll(fd, bytes.data(), bytes.size());
+#endif
+        if (close(fd) != 0 && error == 0) {
+            error = errno;
+        }
+        if (error != 0) {
+            throwWriteError(error, filename);
+        }
+#else
+        (void) preallocate;
+        (void) direct;
+        std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file) {
+            throwWriteError(EIO, filename);
+        }
+#endif
+    }
+}
+
+void FileWriter::writeFile(const std::string &filename, std::span<const std::uint8_t> bytes) {
+    writeWholeFile(filename, bytes, false, false);
+}
+
+void FileWriter::write(const std::filesystem::path &directory, const std::vector<Output> &outputs) {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<AlignedBuffer>> buffers;
+    std::unordered_set<std::string> directories;
+
+    ThreadPool pool(threadCount);
+    for (const auto &output : outputs) {
+        pool.submit([&, this] {
+            auto path = directory / output.name;
+            std::unique_ptr<AlignedBuffer> buffer;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // Packages are shared by many classes, so each directory is only created once. It is only recorded
+                // once created, so a failure is retried by the next class in the package.
+                auto parent = path.parent_path().string();
+                if (!directories.contains(parent)) {
+                    std::filesystem::create_directories(parent);
+                    directories.insert(std::move(parent));
+                }
+                if (!buffers.empty()) {
+                    buffer = std::move(buffers.back());
+                    buffers.pop_back();
+                }
+            }
+            if (!buffer) {
+                buffer = std::make_unique<AlignedBuffer>();
+            }
+
+            auto bytes = buffer->get(output.node->getSerializedSize());
+            output.node->serializeInto(bytes);
+            try {
+                writeWholeFile(path.string(), bytes, preallocate, direct);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffers.push_back(std::move(buffer));
+                throw;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.push_back(std::move(buffer));
+        });
+    }
+    pool.wait();
+}
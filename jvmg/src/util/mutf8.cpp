@@ -0,0 +1,343 @@
+//
+// Created by Micky on 2/15/2024.
+//
+
+#include "jvmg/util/mutf8.h"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JVMG_HAS_SSE2 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+// AVX2 kernels are compiled alongside the baseline and picked at runtime
+#define JVMG_HAS_AVX2 1
+#endif
+#endif
+
+using namespace jvmg;
+
+namespace {
+    constexpr char16_t HIGH_SURROGATE_FIRST = 0xD800;
+    constexpr char16_t LOW_SURROGATE_FIRST = 0xDC00;
+    constexpr char16_t LOW_SURROGATE_LAST = 0xDFFF;
+    constexpr char16_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+    // 0x01-0x7F, the bytes that stand for themselves
+    bool isPlainASCII(std::uint8_t byte) {
+        return static_cast<std::uint8_t>(byte - 1) < 0x7F;
+    }
+
+    std::size_t asciiPrefixScalar(const std::uint8_t *bytes, std::size_t count) {
+        std::size_t i = 0;
+        while (i < count && isPlainASCII(bytes[i])) {
+            i++;
+        }
+        return i;
+    }
+
+#ifdef JVMG_HAS_SSE2
+    std::size_t asciiPrefixSSE2(const std::uint8_t *bytes, std::size_t count) {
+        const __m128i zero = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+            // One bit per byte that has its high bit set or is zero
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(block) | _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)));
+            if (mask != 0) {
+                return i + std::countr_zero(mask);
+            }
+        }
+        return i + asciiPrefixScalar(bytes + i, count - i);
+    }
+
+    void widenSSE2(const std::uint8_t *bytes, std::size_t count, char16_t *out) {
+        const __m128i zero = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi8(block, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), _mm_unpackhi_epi8(block, zero));
+        }
+        for (; i < count; i++) {
+            out[i] = bytes[i];
+        }
+    }
+#endif
+
+#ifdef JVMG_HAS_AVX2
+    __attribute__((target("avx2")))
+    std::size_t asciiPrefixAVX2(const std::uint8_t *bytes, std::size_t count) {
+        const __m256i zero = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes + i));
+            auto mask = static_cast<unsigned>(_mm256_movemask_epi8(block)) |
+                        static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, zero)));
+            if (mask != 0) {
+                return i + std::countr_zero(mask);
+            }
+        }
+        return i + asciiPrefixSSE2(bytes + i, count - i);
+    }
+
+    bool hasAVX2() {
+        static const bool supported = [] {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }();
+        return supported;
+    }
+#endif
+
+    std::size_t asciiPrefix(const std::uint8_t *bytes, std::size_t count) {
+#ifdef JVMG_HAS_AVX2
+        if (count >= 32 && hasAVX2()) {
+            return asciiPrefixAVX2(bytes, count);
+        }
+#endif
+#ifdef JVMG_HAS_SSE2
+        return asciiPrefixSSE2(bytes, count);
+#else
+        return asciiPrefixScalar(bytes, count);
+#endif
+    }
+
+    void widen(const std::uint8_t *bytes, std::size_t count, char16_t *out) {
+#ifdef JVMG_HAS_SSE2
+        widenSSE2(bytes, count, out);
+#else
+        for (std::size_t i = 0; i < count; i++) {
+            out[i] = bytes[i];
+        }
+#endif
+    }
+
+    // Decodes the code unit starting at bytes[i]. Returns its length in bytes, or 0 if it is malformed.
+    std::size_t decodeUnit(const std::uint8_t *bytes, std::size_t count, std::size_t i, char16_t &unit) {
+        std::uint8_t lead = bytes[i];
+        if (isPlainASCII(lead)) {
+            unit = lead;
+            return 1;
+        }
+        if ((lead & 0xE0) == 0xC0) {
+            if (i + 1 >= count || (bytes[i + 1] & 0xC0) != 0x80) {
+                return 0;
+            }
+            unit = static_cast<char16_t>(((lead & 0x1F) << 6) | (bytes[i + 1] & 0x3F));
+            // C0 80, for NUL, is the only overlong form allowed
+            return unit >= 0x80 || unit == 0 ? 2 : 0;
+        }
+        if ((lead & 0xF0) == 0xE0) {
+            if (i + 2 >= count || (bytes[i + 1] & 0xC0) != 0x80 || (bytes[i + 2] & 0xC0) != 0x80) {
+                return 0;
+            }
+            unit = static_cast<char16_t>(((lead & 0x0F) << 12) | ((bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F));
+            return unit >= 0x800 ? 3 : 0;
+        }
+        // Modified UTF-8 has no 4-byte sequences
+        return 0;
+    }
+
+    void appendUnit(std::string &out, char16_t unit) {
+        if (unit != 0 && unit < 0x80) {
+            out.push_back(static_cast<char>(unit));
+        } else if (unit < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (unit >> 6)));
+            out.push_back(static_cast<char>(0x80 | (unit & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xE0 | (unit >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((unit >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (unit & 0x3F)));
+        }
+    }
+
+    void appendCodePoint(std::string &out, char32_t codePoint) {
+        out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    }
+
+    const std::uint8_t *asBytes(std::string_view string) {
+        return reinterpret_cast<const std::uint8_t *>(string.data());
+    }
+}
+
+std::size_t mutf8::asciiPrefixLength(std::string_view bytes) {
+    return asciiPrefix(asBytes(bytes), bytes.size());
+}
+
+bool mutf8::validate(std::string_view string) {
+    const std::uint8_t *bytes = asBytes(string);
+    std::size_t count = string.size();
+    std::size_t i = 0;
+    char16_t unit;
+    while (i < count) {
+        i += asciiPrefix(bytes + i, count - i);
+        while (i < count && bytes[i] >= 0x80) {
+            std::size_t length = decodeUnit(bytes, count, i, unit);
+            if (length == 0) {
+                return false;
+            }
+            i += length;
+        }
+        // A raw zero byte never appears in modified UTF-8
+        if (i < count && bytes[i] == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::u16string> mutf8::toUTF16(std::string_view string) {
+    const std::uint8_t *bytes = asBytes(string);
+    std::size_t count = string.size();
+    // Every code unit takes at least one byte
+    std::u16string utf16(count, u'\0');
+    char16_t *out = utf16.data();
+
+    std::size_t i = 0;
+    while (i < count) {
+        std::size_t run = asciiPrefix(bytes + i, count - i);
+        widen(bytes + i, run, out);
+        out += run;
+        i += run;
+        while (i < count && bytes[i] >= 0x80) {
+            std::size_t length = decodeUnit(bytes, count, i, *out);
+            if (length == 0) {
+                return std::nullopt;
+            }
+            out++;
+            i += length;
+        }
+        if (i < count && bytes[i] == 0) {
+            return std::nullopt;
+        }
+    }
+    utf16.resize(out - utf16.data());
+    return utf16;
+}
+
+std::optional<std::string> mutf8::toUTF8(std::string_view string) {
+    const std::uint8_t *bytes = asBytes(string);
+    std::size_t count = string.size();
+    // Conversion never makes the string longer
+    std::string utf8;
+    utf8.reserve(count);
+
+    std::size_t i = 0;
+    char16_t unit;
+    while (i < count) {
+        std::size_t run = asciiPrefix(bytes + i, count - i);
+        utf8.append(string.data() + i, run);
+        i += run;
+        while (i < count && bytes[i] >= 0x80) {
+            std::size_t length = decodeUnit(bytes, count, i, unit);
+            if (length == 0) {
+                return std::nullopt;
+            }
+            if (unit == 0) {
+                utf8.push_back('\0');
+            } else if (unit >= HIGH_SURROGATE_FIRST && unit < LOW_SURROGATE_FIRST) {
+                char16_t low = 0;
+                std::size_t lowLength = i + length < count ? decodeUnit(bytes, count, i + length, low) : 0;
+                if (lowLength == 3 && low >= LOW_SURROGATE_FIRST && low <= LOW_SURROGATE_LAST) {
+                    appendCodePoint(utf8, 0x10000 + ((unit - HIGH_SURROGATE_FIRST) << 10) + (low - LOW_SURROGATE_FIRST));
+                    length += lowLength;
+                } else {
+                    appendUnit(utf8, REPLACEMENT_CHARACTER);
+                }
+            } else if (unit >= LOW_SURROGATE_FIRST && unit <= LOW_SURROGATE_LAST) {
+                appendUnit(utf8, REPLACEMENT_CHARACTER);
+            } else {
+                // Everything else is already encoded the standard way
+                utf8.append(string.data() + i, length);
+            }
+            i += length;
+        }
+        if (i < count && bytes[i] == 0) {
+            return std::nullopt;
+        }
+    }
+    return utf8;
+}
+
+std::optional<std::string> mutf8::fromUTF8(std::string_view string) {
+    const std::uint8_t *bytes = asBytes(string);
+    std::size_t count = string.size();
+    std::string modified;
+    modified.reserve(count);
+
+    auto isContinuation = [&](std::size_t index) { return index < count && (bytes[index] & 0xC0) == 0x80; };
+
+    std::size_t i = 0;
+    while (i < count) {
+        std::size_t run = asciiPrefix(bytes + i, count - i);
+        modified.append(string.data() + i, run);
+        i += run;
+        while (i < count && !isPlainASCII(bytes[i])) {
+            std::uint8_t lead = bytes[i];
+            if (lead == 0) {
+                appendUnit(modified, u'\0');
+                i++;
+            } else if ((lead & 0xE0) == 0xC0 && isContinuation(i + 1)) {
+                if (lead < 0xC2) {
+                    return std::nullopt;
+                }
+                modified.append(string.data() + i, 2);
+                i += 2;
+            } else if ((lead & 0xF0) == 0xE0 && isContinuation(i + 1) && isContinuation(i + 2)) {
+                char32_t codePoint = ((lead & 0x0F) << 12) | ((bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F);
+                // Overlong, or a surrogate, which standard UTF-8 does not encode
+                if (codePoint < 0x800 || (codePoint >= HIGH_SURROGATE_FIRST && codePoint <= LOW_SURROGATE_LAST)) {
+                    return std::nullopt;
+                }
+                modified.append(string.data() + i, 3);
+                i += 3;
+            } else if ((lead & 0xF8) == 0xF0 && isContinuation(i + 1) && isContinuation(i + 2) && isContinuation(i + 3)) {
+                char32_t codePoint = ((lead & 0x07) << 18) | ((bytes[i + 1] & 0x3F) << 12) | ((bytes[i + 2] & 0x3F) << 6) | (bytes[i + 3] & 0x3F);
+                if (codePoint < 0x10000 || codePoint > 0x10FFFF) {
+                    return std::nullopt;
+                }
+                // Supplementary characters are written as a surrogate pair
+                codePoint -= 0x10000;
+                appendUnit(modified, static_cast<char16_t>(HIGH_SURROGATE_FIRST + (codePoint >> 10)));
+                appendUnit(modified, static_cast<char16_t>(LOW_SURROGATE_FIRST + (codePoint & 0x3FF)));
+                i += 4;
+            } else {
+                return std::nullopt;
+            }
+        }
+    }
+    return modified;
+}
+
+std::string mutf8::fromUTF16(std::u16string_view utf16) {
+    std::string modified;
+    modified.reserve(utf16.size());
+
+    std::size_t i = 0;
+#ifdef JVMG_HAS_SSE2
+    // Eight code units at a time; blocks that are all ASCII other than NUL are narrowed in one go
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi16(0x80);
+    char narrowed[16];
+    for (; i + 8 <= utf16.size(); i += 8) {
+        __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(utf16.data() + i));
+        __m128i ascii = _mm_and_si128(_mm_cmpgt_epi16(units, zero), _mm_cmplt_epi16(units, limit));
+        if (_mm_movemask_epi8(ascii) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(narrowed), _mm_packus_epi16(units, units));
+            modified.append(narrowed, 8);
+            continue;
+        }
+        for (std::size_t j = i; j < i + 8; j++) {
+            appendUnit(modified, utf16[j]);
+        }
+    }
+#endif
+    for (; i < utf16.size(); i++) {
+        appendUnit(modified, utf16[i]);
+    }
+    return modified;
+}
@@ -0,0 +1,118 @@
+//
+// Created by Micky on 1/22/2024.
+//
+
+#include "jvmg/reader.h"
+
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JVMG_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace jvmg;
+
+// Size of each read issued by the stream backend
+static constexpr std::size_t STREAM_CHUNK_SIZE = 64 * 1024;
+
+Reader::Reader(const std::string &filename) : Reader(filename, MAPPED) {}
+
+Reader::Reader(const std::string &filename, Backend backend) : filename(filename), backend(backend) {
+    if (backend == MAPPED && openMapped()) {
+        return;
+    }
+    openStream();
+}
+
+Reader::Reader(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner)
+    : filename("<memory>"), backend(BUFFER), window(bytes.data()), cursor(bytes.data()), end(bytes.data() + bytes.size()),
+      owner(std::move(owner)) {}
+
+void Reader::reset(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> newOwner) {
+    filename = "<memory>";
+    srcFile = std::ifstream();
+    backend = BUFFER;
+    window = bytes.data();
+    cursor = window;
+    end = window + bytes.size();
+    windowOffset = 0;
+    owner = std::move(newOwner);
+}
+
+bool Reader::openMapped() {
+#ifdef JVMG_HAS_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    // Class files are consumed front to back exactly once
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+    std::size_t size = st.st_size;
+    // Unmapped once the Reader and every attribute still pointing into the file are gone
+    owner = std::shared_ptr<const void>(addr, [size](const void *mapping) { munmap(const_cast<void *>(mapping), size); });
+    window = static_cast<const std::uint8_t *>(addr);
+    cursor = window;
+    end = window + size;
+    backend = MAPPED;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Reader::openStream() {
+    backend = STREAM;
+    srcFile = std::ifstream(filename, std::ios_base::binary);
+}
+
+void Reader::underflow(std::size_t count) {
+    if (!refill(count)) {
+        throw std::out_of_range("Unexpected end of input in " + filename);
+    }
+}
+
+bool Reader::refill(std::size_t count) {
+    if (backend != STREAM) {
+        return false;
+    }
+
+    // Slide the unread tail to the front of the buffer and top it up from the file
+    std::size_t remaining = end - cursor;
+    std::size_t consumed = cursor - window;
+    if (remaining > 0 && consumed > 0) {
+        std::memmove(streamBuffer.data(), cursor, remaining);
+    }
+    windowOffset += consumed;
+
+    streamBuffer.resize(std::max(count, STREAM_CHUNK_SIZE));
+    std::size_t filled = remaining;
+    while (filled < count && srcFile) {
+        srcFile.read(reinterpret_cast<char *>(streamBuffer.data() + filled),
+                     static_cast<std::streamsize>(streamBuffer.size() - filled));
+        filled += srcFile.gcount();
+    }
+
+    window = streamBuffer.data();
+    cursor = window;
+    end = window + filled;
+
+    return filled >= count;
+}
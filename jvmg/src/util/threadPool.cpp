@@ -0,0 +1,118 @@
+//
+// Created by Micky on 2/5/2024.
+//
+
+#include "jvmg/util/threadPool.h"
+
+#include <algorithm>
+
+using namespace jvmg;
+
+// Lets submit() recognize calls made from inside one of this pool's workers
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local unsigned currentWorker = 0;
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    threadCount = std::max(threadCount, 1u);
+    for (unsigned i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    unsigned index = currentPool == this ? currentWorker : nextQueue++ % getThreadCount();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        {
+            std::lock_guard<std::mutex> queueLock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        queuedCount++;
+        pendingCount++;
+    }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pendingCount == 0; });
+
+    if (firstError) {
+        auto error = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool ThreadPool::takeTask(unsigned index, Task &task) {
+    auto threadCount = getThreadCount();
+    bool found = false;
+
+    // Own deque from the front, victims from the back
+    for (unsigned i = 0; i < threadCount && !found; i++) {
+        auto &queue = *queues[(index + i) % threadCount];
+        std::lock_guard<std::mutex> queueLock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        } else {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        found = true;
+    }
+
+    if (found) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queuedCount--;
+    }
+    return found;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    currentPool = this;
+    currentWorker = index;
+
+    while (true) {
+        Task task;
+        if (!takeTask(index, task)) {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return queuedCount > 0 || stopping; });
+            if (stopping && queuedCount == 0) {
+                return;
+            }
+            continue;
+        }
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--pendingCount == 0) {
+            allDone.notify_all();
+        }
+    }
+}
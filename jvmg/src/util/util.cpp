@@ -3,43 +3,101 @@
 //
 
 #include "jvmg/util/util.h"
+#include "jvmg/IR/ConstantPool/constantPool.h"
+#include "jvmg/util/fileWriter.h"
+
+#include <stdexcept>
+#include <string>
 
 using namespace jvmg;
 
 std::vector<std::uint8_t>& Serializable::serialize() {
+    auto size = getSerializedSize();
     clearBuffer();
-    _serialize();
+    _buffer.resize(size);
+    serializeInto(_buffer);
     return getBytes();
 }
 
-void Serializable::insertBytes(std::vector<std::uint8_t> &bytes) {
-    _buffer.insert(_buffer.end(), bytes.begin(), bytes.end());
+std::size_t Serializable::getSerializedSize() {
+    Output sizing;
+    output = &sizing;
+    serializeSelf();
+    output = nullptr;
+    return sizing.size;
 }
 
-void Serializable::serializeBytes(std::uint8_t bytes) {
-    _buffer.push_back(bytes);
+void Serializable::serializeInto(std::span<std::uint8_t> out) {
+    Output writing{out.data()};
+    output = &writing;
+    serializeSelf();
+    output = nullptr;
 }
 
-void Serializable::serializeBytes(std::uint16_t bytes) {
-    _buffer.push_back((std::uint8_t) ((bytes & 0xFF00) >> 8));
-    _buffer.push_back((std::uint8_t) (bytes & 0xFF));
+void Serializable::serializeChild(Serializable &child) {
+    child.output = output;
+    child.serializeSelf();
+    child.output = nullptr;
 }
 
-void Serializable::serializeBytes(std::uint32_t bytes) {
-    _buffer.push_back((std::uint8_t) ((bytes & 0xFF000000) >> 24));
-    _buffer.push_back((std::uint8_t) ((bytes & 0xFF0000) >> 16));
-    _buffer.push_back((std::uint8_t) ((bytes & 0xFF00) >> 8));
-    _buffer.push_back((std::uint8_t) (bytes & 0xFF));
+void Serializable::serializeSelf() {
+    auto unchanged = getUnchangedBytes();
+    if (!unchanged.empty()) {
+        insertBytes(unchanged);
+        return;
+    }
+    _serialize();
 }
 
-void Serializable::outputToFile(std::string_view filename) {
-    std::ofstream outputStream(filename.data(), std::ios::out | std::ios::binary);
+std::uint32_t Serializable::serializeChildWithLength(Serializable &child) {
+    auto *lengthAt = output->cursor;
+    serializeBytes(std::uint32_t(0));
+    auto start = output->size;
+    serializeChild(child);
 
-    if (_buffer.empty()) {
-        _serialize();
+    auto length = output->size - start;
+    if (length > UINT32_MAX) {
+        throw std::length_error("Attribute longer than 4 GiB");
     }
+    if (lengthAt != nullptr) {
+        std::uint8_t encoded[4] = {static_cast<std::uint8_t>(length >> 24), static_cast<std::uint8_t>(length >> 16),
+                                   static_cast<std::uint8_t>(length >> 8), static_cast<std::uint8_t>(length)};
+        std::memcpy(lengthAt, encoded, sizeof(encoded));
+    }
+    return static_cast<std::uint32_t>(length);
+}
 
-    for (auto byte : _buffer) {
-        outputStream.write((char *) &byte, sizeof(std::uint8_t));
+void Serializable::serializeCount(std::uint16_t &count, std::size_t actual) {
+    if (actual > UINT16_MAX) {
+        throw std::length_error("Count " + std::to_string(actual) + " does not fit in a u2");
     }
-}
\ No newline at end of file
+    count = static_cast<std::uint16_t>(actual);
+    serializeBytes(count);
+}
+
+void Serializable::outputToFile(std::string_view filename) {
+    FileWriter::writeFile(std::string(filename), serialize());
+}
+
+void SourceBacked::setSource(std::span<const std::uint8_t> bytes, std::shared_ptr<const void> owner,
+                             const std::shared_ptr<const ConstantPool> &constantPool) {
+    source = bytes;
+    sourceOwner = std::move(owner);
+    sourcePool = constantPool;
+    sourcePoolGeneration = constantPool ? constantPool->getGeneration() : 0;
+    sourcePoolCount = constantPool ? constantPool->getCount() : 0;
+    dirty = false;
+}
+
+bool SourceBacked::isUnchanged() const {
+    if (source.empty() || dirty) {
+        return false;
+    }
+    auto pool = sourcePool.lock();
+    if (!pool || pool->getGeneration() != sourcePoolGeneration || pool->getCount() < sourcePoolCount
+        || !contentsUnchanged()) {
+        dirty = true;
+        return false;
+    }
+    return true;
+}
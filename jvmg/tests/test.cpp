@@ -4,7 +4,15 @@
 #include <gtest/gtest.h>
 
 #include "jvmg/reader.h"
+#include "jvmg/IR/ConstantPool/constantPoolBuilder.h"
 #include "jvmg/parser/parser.h"
+#include "jvmg/archive/inflate.h"
+#include "jvmg/archive/jarReader.h"
+#include "jvmg/parser/batchParser.h"
+#include "jvmg/parser/pipeline.h"
+#include "jvmg/util/fileWriter.h"
+#include "jvmg/util/mutf8.h"
+#include "jvmg/util/threadPool.h"
 
 using namespace jvmg;
 
@@ -32,4 +40,1011 @@ TEST_F(InstructionTestFixture, AllInstructionsTagTypeValue) {
     EXPECT_EQ(AConstNull.getOpcodeFromOpcodeByte(AConstNull.getOpcodeByte()), Instruction::ACONST_NULL);
     EXPECT_EQ(AConstNull.getType(), Instruction::ReferenceTy);
     EXPECT_EQ(AConstNull.getImplicitValue(), Instruction::NULL_VAL);
-}
\ No newline at end of file
+}
+
+TEST(InstructionDecoderTest, DecodesEveryOperandLayout) {
+    std::vector<std::uint8_t> code = {
+            0x2D,                                           // aload_3
+            0x11, 0x01, 0x00,                               // sipush 256
+            0xA9, 0x02,                                     // ret 2
+            0xC6, 0x00, 0x10,                               // ifnull +16
+            0xC4, 0x15, 0x01, 0x00,                         // wide iload 256
+            0xC4, 0x84, 0x01, 0x00, 0xFF, 0xFF,             // wide iinc 256, -1
+            0xAA,                                           // tableswitch, already aligned at offset 20
+            0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+            0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x30,
+            0xAB, 0x00, 0x00, 0x00,                         // lookupswitch, padded to offset 44
+            0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x01,
+            0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00, 0x40,
+            0xB9, 0x00, 0x05, 0x02, 0x00,                   // invokeinterface #5, 2
+    };
+    std::vector<std::size_t> sizes = {1, 3, 2, 3, 4, 6, 21, 20, 5};
+
+    Parser parser{std::span<const std::uint8_t>(code)};
+    std::vector<std::uint8_t> reserialized;
+    for (auto size : sizes) {
+        auto instruction = parser.consumeInstruction();
+        EXPECT_EQ(instruction.getSizeInBytes(), size);
+        auto &bytes = instruction.serialize();
+        reserialized.insert(reserialized.end(), bytes.begin(), bytes.end());
+    }
+    EXPECT_EQ(reserialized, code);
+
+    std::vector<std::uint8_t> reserved = {0xCB};
+    Parser invalid{std::span<const std::uint8_t>(reserved)};
+    EXPECT_THROW(invalid.consumeInstruction(), std::invalid_argument);
+}
+
+TEST(InstructionStreamTest, IndexesByPositionAndBci) {
+    std::vector<std::uint8_t> code = {
+            0x2A,                   // aload_0
+            0x10, 0xFE,             // bipush -2
+            0xB7, 0x00, 0x01,       // invokespecial #1
+            0xC4, 0x84, 0x01, 0x00, 0x00, 0x05, // wide iinc 256, 5
+            0xA7, 0xFF, 0xF4,       // goto -12
+    };
+    Parser parser{std::span<const std::uint8_t>(code)};
+    InstructionStream stream;
+    while (stream.getCodeLength() < code.size()) {
+        parser.consumeInstruction(stream);
+    }
+
+    ASSERT_EQ(stream.size(), 5);
+    EXPECT_TRUE(std::equal(stream.getBytes().begin(), stream.getBytes().end(), code.begin(), code.end()));
+    EXPECT_EQ(std::vector<std::uint32_t>(stream.getBcis().begin(), stream.getBcis().end()), (std::vector<std::uint32_t>{0, 1, 3, 6, 12}));
+    EXPECT_EQ(std::vector<std::int32_t>(stream.getOperandWords().begin(), stream.getOperandWords().end()),
+              (std::vector<std::int32_t>{0, -2, 1, 256, -12}));
+
+    EXPECT_EQ(stream.indexOfBci(6), 3);
+    EXPECT_EQ(stream.indexOfBci(7), std::nullopt);
+
+    auto aload = stream[0];
+    EXPECT_EQ(aload.getType(), Instruction::ReferenceTy);
+    EXPECT_EQ(aload.getImplicitValue(), Instruction::ZERO);
+
+    std::size_t bytes = 0;
+    for (const auto &instruction : stream) {
+        bytes += instruction.getSizeInBytes();
+    }
+    EXPECT_EQ(bytes, code.size());
+
+    auto invoke = stream[2].toInstruction();
+    EXPECT_EQ(invoke.getOpcodeByte(), 0xB7);
+    EXPECT_EQ(invoke.getOperands(), (std::vector<std::uint8_t>{0x00, 0x01}));
+
+    // Standalone instructions can be laid out into a stream too
+    InstructionStream built({ALoad0, InvokeSpecial(0x0001), Return});
+    EXPECT_EQ(built.getCodeLength(), 5);
+    EXPECT_EQ(built[2].getBci(), 4);
+
+    // Iterators work with the standard algorithms, ranges included
+    EXPECT_EQ(std::distance(built.begin(), built.end()), 3);
+    auto it = built.begin();
+    std::advance(it, 2);
+    EXPECT_EQ((*it).getOpcodeByte(), 0xB1);
+    EXPECT_EQ(built.end() - it, 1);
+    EXPECT_EQ(it[-1].getBci(), 1);
+    auto invokes = std::ranges::count_if(built, [](InstructionView view) { return view.getOpcodeByte() == 0xB7; });
+    EXPECT_EQ(invokes, 1);
+}
+
+TEST(MUTF8Test, ValidatesAndTranscodes) {
+    EXPECT_TRUE(mutf8::validate("java/lang/Object"));
+    EXPECT_TRUE(mutf8::validate("\xC0\x80"));
+    EXPECT_FALSE(mutf8::validate(std::string_view("a\0b", 3)));
+    EXPECT_FALSE(mutf8::validate("\xC1\x81"));
+    EXPECT_FALSE(mutf8::validate("\xE0\x81\x81"));
+    EXPECT_FALSE(mutf8::validate("\xF0\x9F\x98\x80"));
+    EXPECT_FALSE(mutf8::validate("\xE4\xB8"));
+
+    // U+1F600 as a surrogate pair, and the standard encodings of the same character
+    std::string_view pair = "\xED\xA0\xBD\xED\xB8\x80";
+    EXPECT_TRUE(mutf8::validate(pair));
+    EXPECT_EQ(mutf8::toUTF8(pair), "\xF0\x9F\x98\x80");
+    EXPECT_EQ(mutf8::toUTF16(pair), u"\U0001F600");
+    EXPECT_EQ(mutf8::fromUTF8("\xF0\x9F\x98\x80"), pair);
+    EXPECT_EQ(mutf8::fromUTF16(u"\U0001F600"), pair);
+
+    EXPECT_EQ(mutf8::toUTF8("\xC0\x80"), std::string(1, '\0'));
+    EXPECT_EQ(mutf8::fromUTF8(std::string_view("\0", 1)), "\xC0\x80");
+    EXPECT_EQ(mutf8::toUTF8("\xED\xA0\xBD"), "\xEF\xBF\xBD");
+    EXPECT_EQ(mutf8::fromUTF8("\xED\xA0\xBD"), std::nullopt);
+    EXPECT_EQ(mutf8::toUTF16("\xC1\x81"), std::nullopt);
+
+    // Long enough for the vector kernels, with the first non-ASCII character past the first block
+    std::string text(70, 'a');
+    text += "\xC3\xA9";
+    text += std::string(40, 'b');
+    EXPECT_EQ(mutf8::asciiPrefixLength(text), 70);
+    EXPECT_TRUE(mutf8::validate(text));
+    auto utf16 = mutf8::toUTF16(text);
+    ASSERT_TRUE(utf16.has_value());
+    EXPECT_EQ(utf16->size(), 111);
+    EXPECT_EQ((*utf16)[70], u'\u00E9');
+    EXPECT_EQ(mutf8::fromUTF16(*utf16), text);
+    EXPECT_EQ(mutf8::toUTF8(text), text);
+
+    std::ifstream file("data/classFiles/Main.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Parser parser{std::span<const std::uint8_t>(bytes)};
+    parser.setValidateUTF8(true);
+    EXPECT_TRUE(parser.parseClassFile().has_value());
+
+    std::string_view object = "java/lang/Object";
+    auto position = std::search(bytes.begin(), bytes.end(), object.begin(), object.end());
+    ASSERT_NE(position, bytes.end());
+    *position = 0xFF;
+    Parser corruptParser{std::span<const std::uint8_t>(bytes)};
+    corruptParser.setValidateUTF8(true);
+    auto corrupt = corruptParser.parseClassFile();
+    ASSERT_FALSE(corrupt.has_value());
+    EXPECT_EQ(corrupt.error().reason, ParseError::BAD_UTF8);
+}
+
+TEST(ReaderTest, MappedAndStreamBackendsAgree) {
+    Reader mapped("data/classFiles/Main.class", Reader::MAPPED);
+    Reader stream("data/classFiles/Main.class", Reader::STREAM);
+    EXPECT_EQ(stream.getBackend(), Reader::STREAM);
+    EXPECT_TRUE(stream.getBuffer().empty());
+
+    EXPECT_EQ(mapped.readFourBytes(), CLASS_MAGIC);
+    EXPECT_EQ(stream.readFourBytes(), CLASS_MAGIC);
+    EXPECT_EQ(mapped.readEightBytes(), stream.readEightBytes());
+
+    auto mappedBytes = mapped.readBytes(16);
+    std::vector<std::uint8_t> mappedCopy(mappedBytes.begin(), mappedBytes.end());
+    auto streamBytes = stream.readBytes(16);
+    EXPECT_TRUE(std::equal(mappedCopy.begin(), mappedCopy.end(), streamBytes.begin()));
+    EXPECT_EQ(mapped.getOffset(), 28);
+    EXPECT_EQ(stream.getOffset(), 28);
+
+    EXPECT_THROW(mapped.skipBytes(1 << 20), std::out_of_range);
+    EXPECT_THROW(stream.skipBytes(1 << 20), std::out_of_range);
+}
+
+TEST(ConstantPoolTest, TypedAccessorsAndWideEntries) {
+    ConstantPool pool;
+    auto name = pool.addUTF8("java/lang/Object");
+    auto klass = pool.addClass(name);
+    auto big = pool.addLong(-5000000000);
+    auto pi = pool.addDouble(3.25);
+    auto answer = pool.addInteger(-42);
+    auto half = pool.addFloat(0.5f);
+
+    // Long and Double each take two slots
+    EXPECT_EQ(pi, big + 2);
+    EXPECT_EQ(answer, pi + 2);
+    EXPECT_EQ(pool.getTag(big + 1), ConstantPool::UNUSABLE);
+    EXPECT_EQ(pool.getCount(), half + 1);
+
+    EXPECT_EQ(pool.utf8(pool.classNameIndex(klass)), "java/lang/Object");
+    EXPECT_EQ(pool.longValue(big), -5000000000);
+    EXPECT_EQ(pool.doubleValue(pi), 3.25);
+    EXPECT_EQ(pool.intValue(answer), -42);
+    EXPECT_EQ(pool.floatValue(half), 0.5f);
+    EXPECT_THROW((void) pool.classNameIndex(name), std::invalid_argument);
+    EXPECT_THROW((void) pool.getTag(pool.getCount()), std::out_of_range);
+
+    // constant_pool_count is a u2, so nothing may go past index 65534
+    ConstantPool full;
+    while (full.getCount() < UINT16_MAX - 1) {
+        full.addInteger(full.getCount());
+    }
+    EXPECT_THROW(full.addLong(0), std::length_error);
+    EXPECT_EQ(full.addInteger(0), UINT16_MAX - 1);
+    EXPECT_THROW(full.addUTF8("x"), std::length_error);
+    EXPECT_EQ(full.getCount(), UINT16_MAX);
+
+    // Serialized entries skip the unusable slots
+    std::vector<std::uint8_t> expectedLong = {ConstantPool::CONSTANT_Long, 0xFF, 0xFF, 0xFF, 0xFE, 0xD5, 0xFA, 0x0E, 0x00};
+    auto &bytes = pool.serialize();
+    EXPECT_EQ(bytes.size(), (1 + 2 + 16) + (1 + 2) + (1 + 8) * 2 + (1 + 4) * 2);
+    EXPECT_TRUE(std::search(bytes.begin(), bytes.end(), expectedLong.begin(), expectedLong.end()) != bytes.end());
+}
+
+TEST(ConstantPoolTest, BuilderReusesIdenticalEntries) {
+    ConstantPoolBuilder builder;
+    auto init = builder.methodRef("java/lang/Object", "<init>", "()V");
+    auto &pool = *builder.getPool();
+    // Utf8 x3, Class, NameAndType, Methodref
+    EXPECT_EQ(pool.getCount(), 7);
+    EXPECT_EQ(builder.methodRef("java/lang/Object", "<init>", "()V"), init);
+    EXPECT_EQ(builder.classRef("java/lang/Object"), pool.memberRef(init).classIndex);
+    EXPECT_EQ(builder.utf8("()V"), pool.nameAndType(pool.memberRef(init).nameAndTypeIndex).descriptorIndex);
+    EXPECT_EQ(pool.getCount(), 7);
+
+    // Same payload under another tag is another entry
+    EXPECT_NE(builder.interfaceMethodRef("java/lang/Object", "<init>", "()V"), init);
+    EXPECT_NE(builder.string("()V"), builder.methodType("()V"));
+
+    // Long and Double take two slots, and floating point values are told apart by their bits
+    auto big = builder.longInteger(-5000000000);
+    EXPECT_EQ(builder.doublePrecision(0.0), big + 2);
+    EXPECT_NE(builder.doublePrecision(-0.0), big + 2);
+    EXPECT_EQ(builder.longInteger(-5000000000), big);
+    EXPECT_EQ(pool.getTag(big + 1), ConstantPool::UNUSABLE);
+    EXPECT_EQ(builder.integer(-5000000000 >> 32), builder.integer(-2));
+    EXPECT_NE(builder.integer(1), builder.floatingPoint(std::bit_cast<float>(1)));
+
+    // Enough entries to grow the table several times
+    std::vector<std::uint16_t> numbers;
+    for (int i = 0; i < 5000; i++) {
+        numbers.push_back(builder.integer(i * 7919));
+    }
+    for (int i = 0; i < 5000; i++) {
+        EXPECT_EQ(builder.integer(i * 7919), numbers[i]);
+    }
+    EXPECT_EQ(pool.intValue(numbers[4321]), 4321 * 7919);
+
+    // An existing pool is indexed up front and only appended to
+    std::ifstream file("data/classFiles/Switch.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Parser parser{std::span<const std::uint8_t>(bytes)};
+    ASSERT_TRUE(parser.parseClassHeader());
+    auto parsed = std::make_shared<ConstantPool>(*parser.getContext()->getConstantPool());
+    auto count = parsed->getCount();
+    std::uint16_t code = 1;
+    while (parsed->getTag(code) != ConstantPool::CONSTANT_Utf8 || parsed->utf8(code) != "Code") {
+        code++;
+    }
+    builder.reset(parsed);
+    EXPECT_EQ(builder.utf8("Code"), code);
+    EXPECT_EQ(parsed->getCount(), count);
+    EXPECT_EQ(builder.utf8("not in Switch.class"), count);
+
+    ConstantPoolBuilder full;
+    for (int i = 1; i < UINT16_MAX; i++) {
+        full.integer(i);
+    }
+    EXPECT_EQ(full.integer(1), 1);
+    EXPECT_THROW(full.integer(0), std::length_error);
+}
+
+TEST(AttributeInfoTest, ResolvesEveryKnownName) {
+    for (std::size_t tag = 0; tag < AttributeInfo::attributeNames.size(); tag++) {
+        EXPECT_EQ(AttributeInfo::getAttributeNameTag(AttributeInfo::attributeNames[tag]), tag);
+    }
+    EXPECT_EQ(AttributeInfo::getAttributeNameTag("RuntimeVisibleParameterAnnotations"), AttributeInfo::RUNTIME_VISIBLE_PARAMETER_ANNOTATIONS);
+    EXPECT_EQ(AttributeInfo::getAttributeNameTag("RuntimeVisibleParamterAnnotations"), AttributeInfo::UNKNOWN);
+    EXPECT_EQ(AttributeInfo::getAttributeNameTag("code"), AttributeInfo::UNKNOWN);
+    EXPECT_EQ(AttributeInfo::getAttributeNameTag(""), AttributeInfo::UNKNOWN);
+}
+
+TEST(ParserTest, ParsesFromMemoryBuffer) {
+    std::ifstream file("data/classFiles/Main.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Parser parser{std::span<const std::uint8_t>(bytes)};
+    auto classFile = parser.consumeClassFile();
+
+    EXPECT_EQ(classFile.getMethodsCount(), 3);
+    EXPECT_EQ(classFile.serialize(), bytes);
+}
+
+TEST(ParserTest, Utf8ConstantsAreViewsIntoConstantPool) {
+    Reader reader("data/classFiles/Minimum.class");
+    Parser parser(&reader);
+    auto classFile = parser.consumeClassFile();
+
+    auto method = classFile.getMethods()[0];
+    auto name = parser.getContext()->getConstantUTF8(method.nameIndex);
+    EXPECT_EQ(name, "<init>");
+    EXPECT_EQ(parser.getContext()->getConstantUTF8(method.nameIndex).data(), name.data());
+    // Straight out of the pool's payload buffer, which the class shares with the parser
+    EXPECT_EQ(classFile.getConstantPool().utf8(method.nameIndex).data(), name.data());
+    EXPECT_EQ(parser.getContext()->getConstantUTF8(method.descriptorIndex), "()V");
+}
+
+TEST(ParserTest, DecodesCodeLazily) {
+    std::ifstream file("data/classFiles/Main.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Parser eagerParser{std::span<const std::uint8_t>(bytes)};
+    auto eager = eagerParser.consumeClassFile();
+
+    Parser lazyParser{std::span<const std::uint8_t>(bytes)};
+    lazyParser.setLazyCode(true);
+    auto lazy = lazyParser.consumeClassFile();
+
+    // Undecoded bodies are written back as they were read
+    EXPECT_EQ(lazy.serialize(), bytes);
+
+    for (std::size_t i = 0; i < lazy.getMethods().size(); i++) {
+        auto lazyCode = (CodeAttribute *) lazy.getMethods()[i].attributes[0]->info;
+        auto eagerCode = (CodeAttribute *) eager.getMethods()[i].attributes[0]->info;
+        EXPECT_FALSE(lazyCode->isDecoded());
+
+        EXPECT_EQ(lazyCode->getCode().size(), eagerCode->getCode().size());
+        EXPECT_TRUE(lazyCode->isDecoded());
+        EXPECT_EQ(lazyCode->getAttributes().size(), eagerCode->getAttributes().size());
+        EXPECT_EQ(lazyCode->serialize(), eagerCode->serialize());
+    }
+
+    // Bodies are views into the input. A decode that fails leaves nothing behind, so a later one starts clean.
+    Parser retryParser{std::span<const std::uint8_t>(bytes)};
+    retryParser.setLazyCode(true);
+    auto retry = retryParser.consumeClassFile();
+    auto retryCode = (CodeAttribute *) retry.getMethods()[1].attributes[0]->info;
+    auto exceptionTableLength = retryCode->getBody().data() - bytes.data() + retryCode->codeLength;
+    EXPECT_GE(exceptionTableLength, 0);
+    bytes[exceptionTableLength] = 0xFF;
+    EXPECT_ANY_THROW(retryCode->getCode());
+    EXPECT_ANY_THROW(retryCode->getCode());
+    EXPECT_FALSE(retryCode->isDecoded());
+    bytes[exceptionTableLength] = 0;
+    auto eagerCode = (CodeAttribute *) eager.getMethods()[1].attributes[0]->info;
+    EXPECT_EQ(retryCode->getCode().size(), eagerCode->getCode().size());
+    EXPECT_EQ(retryCode->getExceptionTable().size(), eagerCode->getExceptionTable().size());
+    EXPECT_EQ(retryCode->getAttributes().size(), eagerCode->getAttributes().size());
+}
+
+TEST(ParserTest, VisitsWithoutBuildingTree) {
+    struct FieldReadCounter : ClassVisitor, MethodVisitor {
+        std::vector<std::string> methods;
+        std::size_t instructions = 0;
+        std::size_t fieldReads = 0;
+
+        MethodVisitor *visitMethod(std::uint16_t, std::string_view name, std::string_view) override {
+            methods.emplace_back(name);
+            // Skip the constructor's body
+            return name == "<init>" ? nullptr : this;
+        }
+        void visitInstruction(const InstructionView &instruction) override {
+            instructions++;
+            if (instruction.getOpcodeByte() == Instruction::GETFIELD) {
+                fieldReads++;
+            }
+        }
+    };
+
+    Reader reader("data/classFiles/Main.class");
+    auto classFile = Parser(&reader).consumeClassFile();
+    std::size_t expectedInstructions = 0;
+    for (const auto &method : classFile.getMethods()) {
+        if (classFile.getConstantPool().utf8(method.nameIndex) != "<init>") {
+            expectedInstructions += ((CodeAttribute *) method.attributes[0]->info)->getCode().size();
+        }
+    }
+
+    FieldReadCounter counter;
+    Reader visitReader("data/classFiles/Main.class");
+    Parser(&visitReader).consumeClassFile(counter);
+    EXPECT_EQ(counter.methods.size(), classFile.getMethodsCount());
+    EXPECT_EQ(counter.instructions, expectedInstructions);
+    // Only test() reads a field; the constructor that writes one was skipped
+    EXPECT_EQ(counter.fieldReads, 1);
+
+    // StackMapTable and other unmodeled attributes are handed over undecoded
+    FieldReadCounter switchCounter;
+    Reader switchReader("data/classFiles/Switch.class");
+    Parser(&switchReader).consumeClassFile(switchCounter);
+    EXPECT_FALSE(switchCounter.methods.empty());
+}
+
+TEST(ParserTest, ReadsHeaderWithoutAttributes) {
+    Reader reader("data/classFiles/Main.class");
+    auto classFile = Parser(&reader).consumeClassFile();
+
+    Reader headerReader("data/classFiles/Main.class");
+    auto header = Parser(&headerReader).consumeClassHeader();
+    EXPECT_EQ(header.majorVersion, classFile.getMajorVersion());
+    EXPECT_EQ(header.accessFlags, classFile.getAccessFlags());
+    EXPECT_EQ(header.getThisClassName(), "Main");
+    EXPECT_EQ(header.getSuperClassName(), "java/lang/Object");
+    EXPECT_EQ(header.fields.size(), classFile.getFieldsCount());
+    ASSERT_EQ(header.methods.size(), classFile.getMethodsCount());
+    for (std::size_t i = 0; i < header.methods.size(); i++) {
+        EXPECT_EQ(header.methods[i].nameIndex, classFile.getMethods()[i].nameIndex);
+    }
+    EXPECT_EQ(header.getName(header.methods[1]), "test");
+    EXPECT_EQ(header.getDescriptor(header.methods[1]), "()I");
+
+    // Member attributes, StackMapTable included, are stepped over without being read
+    Reader switchReader("data/classFiles/Switch.class");
+    EXPECT_EQ(Parser(&switchReader).consumeClassHeader().getThisClassName(), "Switch");
+}
+
+TEST(ParserTest, ReportsErrorsWithoutThrowing) {
+    std::ifstream file("data/classFiles/Main.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto truncated = Parser(std::span<const std::uint8_t>(bytes).first(bytes.size() - 3)).parseClassFile();
+    ASSERT_FALSE(truncated.has_value());
+    EXPECT_EQ(truncated.error().reason, ParseError::TRUNCATED);
+    EXPECT_LE(truncated.error().offset, bytes.size() - 3);
+
+    auto corrupt = bytes;
+    corrupt[0] = 0;
+    auto badMagic = Parser(std::span<const std::uint8_t>(corrupt)).parseClassFile();
+    ASSERT_FALSE(badMagic.has_value());
+    EXPECT_EQ(badMagic.error().reason, ParseError::BAD_MAGIC);
+    EXPECT_EQ(badMagic.error().offset, 4);
+
+    // The first constant's tag follows magic, versions and constant_pool_count
+    corrupt = bytes;
+    corrupt[10] = 2;
+    auto badTag = Parser(std::span<const std::uint8_t>(corrupt)).parseClassHeader();
+    ASSERT_FALSE(badTag.has_value());
+    EXPECT_EQ(badTag.error().reason, ParseError::BAD_CONSTANT_TAG);
+    EXPECT_EQ(badTag.error().offset, 11);
+
+    // The throwing entry point raises the same error
+    EXPECT_THROW(Parser(std::span<const std::uint8_t>(corrupt)).consumeClassFile(), std::invalid_argument);
+
+    // A Long as the last entry would take a slot past constant_pool_count, here both for a small count and for
+    // the largest one a class can declare
+    for (std::uint16_t integers : {0, 65533}) {
+        std::vector<std::uint8_t> wide{0xCA, 0xFE, 0xBA, 0xBE, 0, 0, 0, 65};
+        std::uint16_t count = integers + 2;
+        wide.insert(wide.end(), {static_cast<std::uint8_t>(count >> 8), static_cast<std::uint8_t>(count)});
+        for (std::uint16_t i = 0; i < integers; i++) {
+            wide.insert(wide.end(), {ConstantPool::CONSTANT_Integer, 0, 0, 0, 0});
+        }
+        wide.insert(wide.end(), {ConstantPool::CONSTANT_Long, 0, 0, 0, 0, 0, 0, 0, 1});
+        auto pastCount = Parser(std::span<const std::uint8_t>(wide)).parseClassFile();
+        ASSERT_FALSE(pastCount.has_value());
+        EXPECT_EQ(pastCount.error().reason, ParseError::BAD_CONSTANT_INDEX);
+        EXPECT_EQ(pastCount.error().offset, wide.size());
+    }
+
+    // With Minimum.class's nested attributes_count cleared, its Code attribute ends before attribute_length says.
+    // The tree and the visitor parsers both reject it.
+    std::ifstream minimumFile("data/classFiles/Minimum.class", std::ios::binary);
+    std::vector<std::uint8_t> shortCode((std::istreambuf_iterator<char>(minimumFile)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(shortCode[0xA5], 1);
+    shortCode[0xA5] = 0;
+    auto tree = Parser(std::span<const std::uint8_t>(shortCode)).parseClassFile();
+    ASSERT_FALSE(tree.has_value());
+    EXPECT_EQ(tree.error().reason, ParseError::BAD_LENGTH);
+
+    struct : ClassVisitor, MethodVisitor {
+        MethodVisitor *visitMethod(std::uint16_t, std::string_view, std::string_view) override { return this; }
+    } visitor;
+    auto visited = Parser(std::span<const std::uint8_t>(shortCode)).parseClassFile(visitor);
+    ASSERT_FALSE(visited.has_value());
+    EXPECT_EQ(visited.error().reason, tree.error().reason);
+    EXPECT_EQ(visited.error().offset, tree.error().offset);
+
+    // An attribute_length too short for Code's own fields is a bad length when decoding lazily as well
+    auto tinyCode = shortCode;
+    tinyCode[0xA5] = 1;
+    ASSERT_EQ(tinyCode[0x94], 0x1D);
+    tinyCode[0x94] = 4;
+    Parser lazy{std::span<const std::uint8_t>(tinyCode)};
+    lazy.setLazyCode(true);
+    auto lazyResult = lazy.parseClassFile();
+    ASSERT_FALSE(lazyResult.has_value());
+    EXPECT_EQ(lazyResult.error().reason, ParseError::BAD_LENGTH);
+}
+
+TEST(ParserTest, ReusesStorageAcrossReset) {
+    std::vector<std::vector<std::uint8_t>> inputs;
+    for (auto name : {"data/classFiles/Switch.class", "data/classFiles/Main.class", "data/classFiles/Minimum.class"}) {
+        std::ifstream file(name, std::ios::binary);
+        inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    Parser parser{std::span<const std::uint8_t>(inputs[0])};
+    for (int round = 0; round < 2; round++) {
+        for (auto &input : inputs) {
+            parser.reset(input);
+            auto classFile = parser.parseClassFile();
+            ASSERT_TRUE(classFile.has_value());
+            EXPECT_EQ(classFile->serialize(), input);
+        }
+    }
+    // Switch.class has the largest constant pool, so only the first parse grows it
+    EXPECT_EQ(parser.getAllocations().constantPools, 0);
+    EXPECT_EQ(parser.getAllocations().constantPoolGrowths, 1);
+
+    // A pool still held by a result is left alone
+    parser.reset(inputs[1]);
+    auto held = parser.consumeClassFile();
+    parser.reset(inputs[2]);
+    EXPECT_EQ(parser.consumeClassFile().serialize(), inputs[2]);
+    EXPECT_EQ(held.serialize(), inputs[1]);
+    EXPECT_EQ(parser.getAllocations().constantPools, 1);
+
+    // A failed parse leaves nothing behind
+    parser.reset(std::span<const std::uint8_t>(inputs[0]).first(20));
+    EXPECT_FALSE(parser.parseClassFile().has_value());
+    parser.reset(inputs[0]);
+    EXPECT_TRUE(parser.parseClassFile().has_value());
+}
+
+TEST(ParserTest, DecodesMethodsInParallel) {
+    std::ifstream file("data/classFiles/Switch.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    ThreadPool pool(4);
+    auto parseInParallel = [&](std::span<const std::uint8_t> input, std::size_t minimumBytes) {
+        Parser parser(input);
+        parser.setThreadPool(&pool, minimumBytes);
+        return parser.parseClassFile();
+    };
+
+    auto classFile = parseInParallel(bytes, 0);
+    ASSERT_TRUE(classFile.has_value());
+    EXPECT_EQ(classFile->serialize(), bytes);
+
+    // Always split; only found too small by the scan, which is undone; too small for what is left of the input
+    std::size_t methodBytes = 0;
+    for (auto &method : classFile->getMethods()) {
+        methodBytes += const_cast<ClassFile::MethodInfo &>(method).getSerializedSize();
+    }
+    for (std::size_t minimumBytes : {std::size_t(0), methodBytes + 1, bytes.size()}) {
+        // Damage anywhere is reported exactly as a sequential parse reports it
+        for (std::size_t i = 0; i < bytes.size(); i++) {
+            auto corrupt = bytes;
+            corrupt[i] ^= 0xFF;
+            auto sequential = Parser(std::span<const std::uint8_t>(corrupt)).parseClassFile();
+            auto parallel = parseInParallel(corrupt, minimumBytes);
+            ASSERT_EQ(parallel.has_value(), sequential.has_value()) << "byte " << i;
+            if (sequential) {
+                EXPECT_EQ(parallel->serialize(), sequential->serialize()) << "byte " << i;
+            } else {
+                EXPECT_EQ(parallel.error().reason, sequential.error().reason) << "byte " << i;
+                EXPECT_EQ(parallel.error().offset, sequential.error().offset) << "byte " << i;
+            }
+        }
+    }
+
+    // A parse running on the pool's only worker still finishes, decoding every method itself
+    ThreadPool single(1);
+    std::optional<std::vector<std::uint8_t>> nested;
+    single.submit([&] {
+        Parser parser{std::span<const std::uint8_t>(bytes)};
+        parser.setThreadPool(&single, 0);
+        nested = parser.consumeClassFile().serialize();
+    });
+    single.wait();
+    EXPECT_EQ(nested, bytes);
+}
+
+TEST(ParserTest, KeepsUnmodeledAttributesAsRawBytes) {
+    std::ifstream file("data/classFiles/Switch.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Parser parser{std::span<const std::uint8_t>(bytes)};
+    auto classFile = parser.consumeClassFile();
+    EXPECT_EQ(classFile.serialize(), bytes);
+
+    RawAttribute *stackMapTable = nullptr;
+    for (auto &method : classFile.getMethods()) {
+        for (auto *attribute : ((CodeAttribute *) method.attributes[0]->info)->getAttributes()) {
+            if (attribute->getAttributeName() == "StackMapTable") {
+                stackMapTable = dynamic_cast<RawAttribute *>(attribute->info);
+            }
+        }
+    }
+    ASSERT_NE(stackMapTable, nullptr);
+    // Not copied: the bytes are a view into the input
+    EXPECT_GE(stackMapTable->bytes.data(), bytes.data());
+    EXPECT_LE(stackMapTable->bytes.data() + stackMapTable->bytes.size(), bytes.data() + bytes.size());
+
+    // Mapped and streamed inputs stay readable after their Reader is gone
+    for (auto backend : {Reader::MAPPED, Reader::STREAM}) {
+        std::optional<ClassFile> fromFile;
+        {
+            Reader reader("data/classFiles/Switch.class", backend);
+            fromFile.emplace(Parser(&reader).consumeClassFile());
+        }
+        EXPECT_EQ(fromFile->serialize(), bytes);
+    }
+}
+
+TEST(ParserTest, SkipsAttributesSelectedByOptions) {
+    std::ifstream file("data/classFiles/Switch.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto names = [](const std::vector<AttributeInfo *> &attributes) {
+        std::vector<std::string> result;
+        for (auto *attribute : attributes) {
+            result.push_back(attribute->getAttributeName());
+        }
+        return result;
+    };
+
+    // Dropped attributes leave no trace, and the class still serializes to a well-formed file
+    Parser parser{std::span<const std::uint8_t>(bytes)};
+    parser.setOptions(ParseOptions::SKIP_DEBUG);
+    auto stripped = parser.consumeClassFile();
+    EXPECT_TRUE(names(stripped.getAttributes()).empty());
+    auto *code = (CodeAttribute *) stripped.getMethods()[1].attributes[0]->info;
+    EXPECT_EQ(names(code->getAttributes()), std::vector<std::string>{"StackMapTable"});
+
+    auto strippedBytes = stripped.serialize();
+    EXPECT_LT(strippedBytes.size(), bytes.size());
+    auto reparsed = Parser{std::span<const std::uint8_t>(strippedBytes)}.consumeClassFile();
+    EXPECT_EQ(reparsed.serialize(), strippedBytes);
+
+    // Kept skipped attributes are written back unchanged
+    Parser keepingParser{std::span<const std::uint8_t>(bytes)};
+    keepingParser.setOptions(ParseOptions::SKIP_DEBUG | ParseOptions::SKIP_CODE | ParseOptions::KEEP_RAW);
+    auto kept = keepingParser.consumeClassFile();
+    EXPECT_NE(dynamic_cast<RawAttribute *>(kept.getMethods()[1].attributes[0]->info), nullptr);
+    EXPECT_EQ(kept.serialize(), bytes);
+
+    // The visitor parser steps over the same attributes
+    struct CodeCounter : ClassVisitor, MethodVisitor {
+        int codes = 0;
+        int attributes = 0;
+        MethodVisitor *visitMethod(std::uint16_t, std::string_view, std::string_view) override { return this; }
+        bool visitCode(std::uint16_t, std::uint16_t, std::uint32_t) override { codes++; return true; }
+        void visitCodeAttribute(std::string_view, std::span<const std::uint8_t>) override { attributes++; }
+        void visitEnd() override {}
+    } counter;
+    Parser visitingParser{std::span<const std::uint8_t>(bytes)};
+    visitingParser.setOptions(ParseOptions::SKIP_DEBUG);
+    visitingParser.consumeClassFile(counter);
+    EXPECT_EQ(counter.codes, stripped.getMethodsCount());
+    EXPECT_EQ(counter.attributes, 1);
+}
+
+TEST(SerializableTest, WritesWholeClassIntoOneBuffer) {
+    std::ifstream file("data/classFiles/Switch.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto classFile = Parser{std::span<const std::uint8_t>(bytes)}.consumeClassFile();
+    EXPECT_EQ(classFile.serialize(), bytes);
+    EXPECT_EQ(classFile.getBytes().capacity(), bytes.size());
+
+    // Children wrote into the class's buffer and kept no copy of their own
+    auto &method = const_cast<ClassFile::MethodInfo &>(classFile.getMethods()[1]);
+    EXPECT_TRUE(method.getBytes().empty());
+    EXPECT_TRUE(method.attributes[0]->getBytes().empty());
+
+    // Any node can still be serialized on its own
+    auto methodBytes = method.serialize();
+    EXPECT_NE(std::search(bytes.begin(), bytes.end(), methodBytes.begin(), methodBytes.end()), bytes.end());
+}
+
+TEST(SerializableTest, DerivesLengthsAndCounts) {
+    std::ifstream file("data/classFiles/Minimum.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto parsed = Parser{std::span<const std::uint8_t>(bytes)}.consumeClassFile();
+
+    // Minimum.class rebuilt by hand with every length and count left at 0
+    auto constantPool = std::make_shared<ConstantPool>();
+    constantPool->addMethodRef(0x0002, 0x0003);
+    constantPool->addClass(0x0004);
+    constantPool->addNameAndType(0x0005, 0x0006);
+    constantPool->addUTF8("java/lang/Object");
+    constantPool->addUTF8("<init>");
+    constantPool->addUTF8("()V");
+    constantPool->addClass(0x0008);
+    constantPool->addUTF8("Minimum");
+    constantPool->addUTF8("Code");
+    constantPool->addUTF8("LineNumberTable");
+    constantPool->addUTF8("SourceFile");
+    constantPool->addUTF8("Minimum.java");
+
+    // The class takes ownership of every attribute handed to it
+    auto *lineNumbersInfo = new AttributeInfo(0x000A, 0, new LineNumberAttribute(0, {{0, 1}}));
+    auto *code = new CodeAttribute(1, 1, 0, std::vector<Instruction>{ALoad0, InvokeSpecial(0x0001), Return}, 0, {}, 0, {lineNumbersInfo});
+    auto *codeInfo = new AttributeInfo(0x0009, 0, code);
+    auto *sourceFileInfo = new AttributeInfo(0x000B, 0, new SourceFileAttribute(0x000C, "Minimum.java"));
+    ClassFile handwritten(parsed.getMinorVersion(), parsed.getMajorVersion(), 0, constantPool,
+                          ClassFile::ACC_PUBLIC | ClassFile::ACC_SUPER, 0x0007, 0x0002, 0, {}, 0, {}, 0,
+                          {ClassFile::MethodInfo(0x0001, 0x0005, 0x0006, 0, {codeInfo})}, 0, {sourceFileInfo});
+
+    EXPECT_EQ(handwritten.getMethodsCount(), 1);
+    EXPECT_EQ(handwritten.serialize(), bytes);
+    EXPECT_EQ(code->codeLength, 5);
+    EXPECT_EQ(codeInfo->attributeLength, 29);
+    EXPECT_EQ(lineNumbersInfo->attributeLength, 6);
+
+    // Edits are picked up on the next write
+    code->getCode() = InstructionStream(std::vector<Instruction>{Return});
+    code->getAttributes().clear();
+    std::unique_ptr<AttributeInfo> removedLineNumbers(lineNumbersInfo);
+    auto edited = handwritten.serialize();
+    EXPECT_EQ(edited.size(), bytes.size() - 4 - 12);
+    EXPECT_EQ(codeInfo->attributeLength, 13);
+    auto reparsed = Parser{std::span<const std::uint8_t>(edited)}.consumeClassFile();
+    EXPECT_EQ(((CodeAttribute *) reparsed.getMethods()[0].attributes[0]->info)->getCode().getCodeLength(), 1);
+}
+
+TEST(SerializableTest, CopiesUnchangedMembersThrough) {
+    std::ifstream file("data/classFiles/Switch.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Parser parser{std::span<const std::uint8_t>(bytes)};
+    parser.setOptions(ParseOptions::COPY_UNCHANGED);
+    auto classFile = parser.consumeClassFile();
+    for (const auto &method : classFile.getMethods()) {
+        EXPECT_TRUE(method.isUnchanged());
+        EXPECT_GE(method.getSource().data(), bytes.data());
+        EXPECT_LE(method.getSource().data() + method.getSource().size(), bytes.data() + bytes.size());
+    }
+    EXPECT_EQ(classFile.serialize(), bytes);
+
+    // Changed header fields are noticed without marking anything
+    auto &method = const_cast<ClassFile::MethodInfo &>(classFile.getMethods()[1]);
+    method.accessFlags |= ClassFile::MethodInfo::ACC_FINAL;
+    EXPECT_FALSE(method.isUnchanged());
+    EXPECT_TRUE(method.attributes[0]->isUnchanged());
+    auto modified = Parser{std::span<const std::uint8_t>(classFile.serialize())}.consumeClassFile();
+    EXPECT_EQ(modified.getMethods()[1].accessFlags, method.accessFlags);
+    // and stay noticed once undone
+    method.accessFlags &= ~ClassFile::MethodInfo::ACC_FINAL;
+    EXPECT_FALSE(method.isUnchanged());
+    EXPECT_EQ(classFile.serialize(), bytes);
+
+    // So are attributes added or removed, even after the new count has been written
+    auto &other = const_cast<ClassFile::MethodInfo &>(classFile.getMethods()[0]);
+    other.attributes.push_back(new AttributeInfo(other.attributes[0]->attributeNameIndex, 0,
+                                                 new RawAttribute({}, nullptr)));
+    EXPECT_FALSE(other.isUnchanged());
+    (void) classFile.serialize();
+    delete other.attributes.back();
+    other.attributes.pop_back();
+    EXPECT_FALSE(other.isUnchanged());
+    EXPECT_EQ(classFile.serialize(), bytes);
+
+    // Code handed out for changing is written from the tree, while reading it through const leaves it copied
+    Parser codeParser{std::span<const std::uint8_t>(bytes)};
+    codeParser.setOptions(ParseOptions::COPY_UNCHANGED | ParseOptions::LAZY_CODE);
+    auto lazyClass = codeParser.consumeClassFile();
+    auto *codeInfo = lazyClass.getMethods()[1].attributes[0];
+    auto *code = dynamic_cast<CodeAttribute *>(codeInfo->info);
+    ASSERT_NE(code, nullptr);
+    EXPECT_FALSE(std::as_const(*code).getCode().getBytes().empty());
+    EXPECT_TRUE(codeInfo->isUnchanged());
+    code->getCode();
+    EXPECT_FALSE(codeInfo->isUnchanged());
+    EXPECT_FALSE(lazyClass.getMethods()[1].isUnchanged());
+    EXPECT_TRUE(lazyClass.getMethods()[0].isUnchanged());
+    EXPECT_EQ(lazyClass.serialize(), bytes);
+
+    // Public fields of decoded attributes are compared with what was read, and their other contents count as
+    // changed once handed out for changing
+    Parser eagerParser{std::span<const std::uint8_t>(bytes)};
+    eagerParser.setOptions(ParseOptions::COPY_UNCHANGED);
+    auto eagerClass = eagerParser.consumeClassFile();
+    auto *sourceFileInfo = eagerClass.getAttributes()[0];
+    auto *sourceFile = dynamic_cast<SourceFileAttribute *>(sourceFileInfo->info);
+    ASSERT_NE(sourceFile, nullptr);
+    EXPECT_TRUE(sourceFileInfo->isUnchanged());
+    sourceFile->sourceFileIndex++;
+    EXPECT_FALSE(sourceFileInfo->isUnchanged());
+    const auto &eagerMethod = eagerClass.getMethods()[0];
+    const auto *eagerCode = dynamic_cast<const CodeAttribute *>(eagerMethod.attributes[0]->info);
+    ASSERT_NE(eagerCode, nullptr);
+    auto *lineNumbers = dynamic_cast<LineNumberAttribute *>(eagerCode->getAttributes()[0]->info);
+    ASSERT_NE(lineNumbers, nullptr);
+    EXPECT_TRUE(eagerMethod.isUnchanged());
+    lineNumbers->getLineNumberTable()[0].lineNumber++;
+    EXPECT_FALSE(eagerMethod.isUnchanged());
+
+    // Clearing the pool leaves every member's indices stale
+    const_cast<ConstantPool &>(lazyClass.getConstantPool()).clear();
+    EXPECT_FALSE(lazyClass.getMethods()[0].isUnchanged());
+
+    // Members that lost an attribute to SKIP_DEBUG are written from the tree
+    Parser skipping{std::span<const std::uint8_t>(bytes)};
+    skipping.setOptions(ParseOptions::SKIP_DEBUG | ParseOptions::COPY_UNCHANGED);
+    auto stripped = skipping.consumeClassFile();
+    EXPECT_FALSE(stripped.getMethods()[1].isUnchanged());
+    EXPECT_EQ(stripped.serialize(), [&] {
+        Parser plain{std::span<const std::uint8_t>(bytes)};
+        plain.setOptions(ParseOptions::SKIP_DEBUG);
+        return plain.consumeClassFile().serialize();
+    }());
+}
+
+TEST(FileWriterTest, WritesClassesIntoDirectoryTree) {
+    auto directory = std::filesystem::temp_directory_path() / "jvmg-file-writer-test";
+    std::filesystem::remove_all(directory);
+
+    std::vector<std::vector<std::uint8_t>> inputs;
+    std::vector<ClassFile> classFiles;
+    for (auto name : {"data/classFiles/Switch.class", "data/classFiles/Main.class"}) {
+        std::ifstream file(name, std::ios::binary);
+        inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        classFiles.push_back(Parser{std::span<const std::uint8_t>(inputs.back())}.consumeClassFile());
+    }
+
+    for (bool direct : {false, true}) {
+        FileWriter writer(2);
+        writer.setDirect(direct);
+        writer.setPreallocate(direct);
+        writer.write(directory, {{"pkg/Switch.class", &classFiles[0]}, {"Main.class", &classFiles[1]}});
+
+        std::ifstream switchFile(directory / "pkg/Switch.class", std::ios::binary);
+        EXPECT_EQ(std::vector<std::uint8_t>(std::istreambuf_iterator<char>(switchFile), std::istreambuf_iterator<char>()), inputs[0]);
+        std::ifstream mainFile(directory / "Main.class", std::ios::binary);
+        EXPECT_EQ(std::vector<std::uint8_t>(std::istreambuf_iterator<char>(mainFile), std::istreambuf_iterator<char>()), inputs[1]);
+        // Classes are serialized into the writer's buffers, not their own
+        EXPECT_TRUE(classFiles[0].getBytes().empty());
+    }
+
+    // outputToFile writes a node as it is now, not as it was last serialized
+    auto &method = const_cast<ClassFile::MethodInfo &>(classFiles[1].getMethods()[0]);
+    method.serialize();
+    method.accessFlags ^= ClassFile::MethodInfo::ACC_FINAL;
+    method.outputToFile((directory / "method").string());
+    std::ifstream methodFile(directory / "method", std::ios::binary);
+    EXPECT_EQ(std::vector<std::uint8_t>(std::istreambuf_iterator<char>(methodFile), std::istreambuf_iterator<char>()), method.serialize());
+    EXPECT_EQ(method.getBytes()[1] & ClassFile::MethodInfo::ACC_FINAL, method.accessFlags & ClassFile::MethodInfo::ACC_FINAL);
+
+    EXPECT_THROW(FileWriter::writeFile((directory / "missing/Main.class").string(), inputs[1]), std::system_error);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(JarReaderTest, YieldsOnlyClassEntries) {
+    JarReader jar("data/jars/classes.jar");
+    EXPECT_EQ(jar.getEntries().size(), 4);
+
+    std::vector<std::string> names;
+    jar.forEachClass([&](const JarReader::Entry& entry, std::span<const std::uint8_t> bytes) {
+        names.push_back(entry.name);
+        EXPECT_EQ(bytes.size(), entry.uncompressedSize);
+
+        std::ifstream file("data/classFiles/" + entry.name.substr(entry.name.rfind('/') + 1), std::ios::binary);
+        std::vector<std::uint8_t> expected((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        EXPECT_TRUE(std::equal(bytes.begin(), bytes.end(), expected.begin(), expected.end()));
+    });
+    EXPECT_EQ(names, (std::vector<std::string>{"Main.class", "Minimum.class", "pkg/Switch.class"}));
+
+    std::vector<std::uint8_t> buffer;
+    auto main = jar.readEntry(jar.getEntries()[1], buffer);
+    Parser parser(main);
+    EXPECT_EQ(parser.consumeClassFile().getMethodsCount(), 3);
+}
+
+TEST(JarReaderTest, RejectsOffsetsPastEnd) {
+    auto put = [](std::vector<std::uint8_t> &bytes, std::uint64_t value, int size) {
+        for (int i = 0; i < std::min(size, 8); i++) {
+            bytes.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+        if (size > 8) {
+            bytes.insert(bytes.end(), size - 8, 0);
+        }
+    };
+    // A ZIP64 end of central directory record, its locator and the end of central directory record
+    auto archive = [&](std::uint64_t zip64Eocd, std::uint64_t entryCount, std::uint64_t directoryOffset) {
+        std::vector<std::uint8_t> bytes;
+        put(bytes, 0x06064B50, 4);
+        put(bytes, 0, 28);
+        put(bytes, entryCount, 8);
+        put(bytes, 0, 8);
+        put(bytes, directoryOffset, 8);
+        put(bytes, 0x07064B50, 4);
+        put(bytes, 0, 4);
+        put(bytes, zip64Eocd, 8);
+        put(bytes, 1, 4);
+        put(bytes, 0x06054B50, 4);
+        put(bytes, 0, 6);
+        put(bytes, 0xFFFF, 2);
+        put(bytes, 0, 4);
+        put(bytes, 0xFFFFFFFF, 4);
+        put(bytes, 0, 2);
+        return bytes;
+    };
+
+    auto wrapped = archive(~0ull - 2, 1, 0);
+    EXPECT_THROW(JarReader{std::span<const std::uint8_t>(wrapped)}, std::runtime_error);
+    auto farDirectory = archive(0, 1, ~0ull - 2);
+    EXPECT_THROW(JarReader{std::span<const std::uint8_t>(farDirectory)}, std::runtime_error);
+    // A huge count is only trusted as far as the archive could hold it
+    auto manyEntries = archive(0, 1ull << 60, 0);
+    EXPECT_THROW(JarReader{std::span<const std::uint8_t>(manyEntries)}, std::runtime_error);
+}
+
+TEST(InflaterTest, DoesNotTrustUncompressedSize) {
+    // A final fixed Huffman block holding nothing but its end-of-block code
+    const std::vector<std::uint8_t> empty{0x03, 0x00};
+    std::vector<std::uint8_t> buffer;
+
+    // Two bytes cannot expand to a terabyte, so nothing is allocated for it
+    EXPECT_THROW(Inflater::inflate(empty, buffer, 1ull << 40), std::runtime_error);
+    EXPECT_EQ(buffer.capacity(), 0);
+    // A plausible size that the stream does not reach is only allocated as far as the output goes
+    EXPECT_THROW(Inflater::inflate(empty, buffer, 2000), std::runtime_error);
+    EXPECT_LT(buffer.capacity(), 2000);
+    Inflater::inflate(empty, buffer, 0);
+    EXPECT_TRUE(buffer.empty());
+}
+
+TEST(BatchParserTest, ReturnsResultsInInputOrder) {
+    std::vector<std::string> filenames = {
+            "data/classFiles/Minimum.class",
+            "data/classFiles/Main.class",
+            "data/classFiles/test.class",
+            "data/classFiles/Main.class"
+    };
+
+    BatchParser batchParser(3);
+    auto classFiles = batchParser.parseFiles(filenames);
+
+    ASSERT_EQ(classFiles.size(), filenames.size());
+    EXPECT_EQ(classFiles[0].getMethodsCount(), 1);
+    EXPECT_EQ(classFiles[1].getMethodsCount(), 3);
+    EXPECT_EQ(classFiles[2].getMethodsCount(), 1);
+    EXPECT_EQ(classFiles[3].getMethodsCount(), 3);
+
+    std::atomic<int> streamed = 0;
+    batchParser.parseFiles(filenames, [&](std::size_t, ClassFile&&) { streamed++; });
+    EXPECT_EQ(streamed, filenames.size());
+
+    std::vector<std::uint8_t> truncated = {0xCA, 0xFE, 0xBA, 0xBE, 0x00};
+    EXPECT_THROW(batchParser.parseBuffers({truncated}), std::out_of_range);
+}
+
+TEST(FileLoaderTest, BackendsLoadSameBytes) {
+    std::vector<std::string> filenames = {
+            "data/classFiles/Main.class",
+            "data/classFiles/Minimum.class",
+            "data/classFiles/Switch.class"
+    };
+
+    for (auto backend : {FileLoader::IO_URING, FileLoader::THREADED}) {
+        FileLoader loader(backend, 2, 2);
+        // io_uring is used wherever the kernel has it, and only when asked for
+        auto expectedBackend = backend == FileLoader::IO_URING && FileLoader::isIoUringAvailable()
+                               ? FileLoader::IO_URING : FileLoader::THREADED;
+        EXPECT_EQ(loader.getBackend(), expectedBackend);
+        std::vector<std::vector<std::uint8_t>> loaded(filenames.size());
+        loader.load(filenames, [&](std::size_t index, std::vector<std::uint8_t>&& bytes) {
+            loaded[index] = std::move(bytes);
+        });
+
+        for (std::size_t i = 0; i < filenames.size(); i++) {
+            std::ifstream file(filenames[i], std::ios::binary);
+            std::vector<std::uint8_t> expected((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            EXPECT_EQ(loaded[i], expected);
+        }
+
+        // Each failure keeps its own error code, and the loader can be used again afterwards
+        auto loadError = [&](const std::string &filename) {
+            try {
+                loader.load({filename}, [](std::size_t, std::vector<std::uint8_t>&&) {});
+            } catch (const std::system_error &error) {
+                return error.code();
+            }
+            return std::error_code();
+        };
+        EXPECT_EQ(loadError("data/classFiles/Missing.class"), std::errc::no_such_file_or_directory);
+        EXPECT_EQ(loadError("data/classFiles"), std::errc::is_a_directory);
+        EXPECT_EQ(loadError(filenames[0]), std::error_code());
+    }
+
+    FileLoader loader;
+    BatchParser batchParser(2);
+    auto classFiles = batchParser.parseFiles({"data/classFiles/Minimum.class", "data/classFiles/Main.class"}, loader);
+    EXPECT_EQ(classFiles[0].getMethodsCount(), 1);
+    EXPECT_EQ(classFiles[1].getMethodsCount(), 3);
+}
+
+TEST(PipelineTest, StreamsJarAndLooseClasses) {
+    PipelineOptions options;
+    options.parseThreads = 2;
+    options.queueCapacity = 2;
+    options.memoryBudget = 512;
+    Pipeline pipeline(options);
+
+    std::mutex mutex;
+    std::map<std::string, ClassFile> classFiles;
+    pipeline.run({"data/jars/classes.jar", "data/classFiles/Minimum.class"}, [&](const std::string& name, ClassFile&& classFile) {
+        std::lock_guard<std::mutex> lock(mutex);
+        classFiles.emplace(name, std::move(classFile));
+    });
+    std::vector<std::string> names;
+    for (const auto &[name, classFile] : classFiles) {
+        names.push_back(name);
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"Main.class", "Minimum.class", "data/classFiles/Minimum.class", "pkg/Switch.class"}));
+
+    // StackMapTable is kept as raw bytes that outlive the pipeline's input buffers
+    std::ifstream file("data/classFiles/Switch.class", std::ios::binary);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(classFiles.at("pkg/Switch.class").serialize(), bytes);
+
+    auto stats = pipeline.run({"data/classFiles/Minimum.class", "data/classFiles/Main.class"},
+                              [](const std::string&, ClassFile&&) {});
+    EXPECT_EQ(stats.read.items, 2);
+    EXPECT_EQ(stats.parse.items, 2);
+    EXPECT_EQ(stats.consume.items, 2);
+    EXPECT_LE(stats.peakBytesInFlight, std::max<std::size_t>(512, std::filesystem::file_size("data/classFiles/Main.class")));
+}